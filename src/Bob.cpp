@@ -3,6 +3,8 @@
 
 void Game::handle_event(SDL_Event *event)
 {
+    ScopedTimer timer("events");
+    TraceSpan span(event_name(event->type), "dispatch");
     static SDL_Point window_size;
     std::string input;
     std::ostringstream prompt;
@@ -137,44 +139,55 @@ void Game::handle_event(SDL_Event *event)
             }
             break;
         default:
-            if ((event->type == BOB_MARKERUPDATE || event->type == BOB_FIELDSELECTEDEVENT)
-                && !this->text_input_box->get_active())
+            if (event->type == BOB_NEXTROUNDEVENT || event->type == BOB_NEXTTURNEVENT)
             {
                 this->grid->handle_event(event);
-                this->field_box->handle_event(event);
                 if (this->started)
                 {
-                    this->upgrade_box->handle_event(event);
-                }
-            }
-            if (event->type == BOB_NEXTROUNDEVENT || event->type == BOB_FIELDUPDATEEVENT
-                || event->type == BOB_FIELDUPGRADEVENT || event->type == BOB_NEXTTURNEVENT)
-            {
-                this->grid->handle_event(event);
-                this->field_box->handle_event(event);
-                this->upgrade_box->handle_event(event);
-            }
-            else if (event->type == BOB_FIELDSELECTEDEVENT && !this->started)
-            {
-                FieldMeta *field = (FieldMeta *) event->user.data1;
-                if (event->user.code == 0 && this->adding != pm->default_player)
-                {
-                    if (this->grid->place(this->adding, field))
-                    {
-                        PlayerManager::pm->add_player(this->adding);
-                        prompt << "Added Player: " << this->adding.get_name();
-                    }
-                    else
-                    {
-                        prompt << "Failed to add Player: " << this->adding.get_name();
-                    }
+                    this->play_bot();
                 }
-                this->text_input_box->prompt(prompt.str());
             }
             break;
     }
 }
 
+void Game::marker_moved(const MarkerMoved &event)
+{
+    if (!this->text_input_box->get_active())
+    {
+        this->field_box->show(event.field);
+    }
+}
+
+void Game::field_selected(const FieldSelected &event)
+{
+    if (this->text_input_box->get_active())
+        return;
+    if (this->started)
+    {
+        this->upgrade_box->select(event.field);
+        return;
+    }
+    if (this->adding == pm->default_player)
+        return;
+    std::ostringstream prompt;
+    if (this->grid->place(this->adding, event.field))
+    {
+        PlayerManager::pm->add_player(this->adding);
+        if (this->adding_bot != nullptr)
+        {
+            this->bots.push_back(std::make_pair(this->adding, this->adding_bot));
+            this->adding_bot = nullptr;
+        }
+        prompt << "Added Player: " << this->adding.get_name();
+    }
+    else
+    {
+        prompt << "Failed to add Player: " << this->adding.get_name();
+    }
+    this->text_input_box->prompt(prompt.str());
+}
+
 void Game::command(std::string input)
 {
     std::ostringstream prompt;
@@ -187,9 +200,44 @@ void Game::command(std::string input)
     {
         prompt << "This is a test!";
     }
-    else if (input == "debug")
+    else if (input == "profile")
+    {
+        bool visible = !this->profile_box->get_visible();
+        this->profile_box->set_visible(visible);
+        this->update_profile_box();
+        prompt << (visible ? "Showing" : "Hiding") << " the frame times.";
+    }
+    else if (input == "trace start")
     {
-        //this->debug->toggle();
+        Trace::start();
+        prompt << "Tracing, write the trace with: trace stop <file>";
+    }
+    else if (input.substr(0, 11) == "trace stop ")
+    {
+        std::string path = input.substr(11, std::string::npos);
+        Trace::stop();
+        if (Trace::write(path))
+        {
+            prompt << "Wrote the trace to " << path;
+        }
+        else
+        {
+            prompt << "Failed to write the trace to " << path;
+        }
+    }
+    else if (input.substr(0, 13) == "profile dump ")
+    {
+        std::string path = input.substr(13, std::string::npos);
+        std::ofstream out(path);
+        Profiler::profiler->dump(out);
+        if (out)
+        {
+            prompt << "Wrote the frame times to " << path;
+        }
+        else
+        {
+            prompt << "Failed to write the frame times to " << path;
+        }
     }
     else if (input == "next")
     {
@@ -221,6 +269,8 @@ void Game::command(std::string input)
             }
             this->grid->set_selecting(true);
             this->adding = Player(input.substr(11, std::string::npos));
+            delete this->adding_bot;
+            this->adding_bot = nullptr;
             prompt << "Select a place for " << this->adding.get_name() << ", please!";
             this->text_input_box->stop();
         }
@@ -229,6 +279,32 @@ void Game::command(std::string input)
             prompt << "The game has already been started. No additional player will be accepted for this game. ";
         }
     }
+    else if (input.substr(0, 8) == "add bot ")
+    {
+        // add bot <type> <name>
+        std::string arguments = input.substr(8, std::string::npos);
+        size_t split = arguments.find(' ');
+        Bot *bot = create_bot(arguments.substr(0, split), BOT_BUDGET, this->grid->get_rng()());
+        if (this->started)
+        {
+            prompt << "The game has already been started. No additional player will be accepted for this game. ";
+            delete bot;
+        }
+        else if (bot == nullptr || split == std::string::npos)
+        {
+            prompt << "Usage: add bot greedy|montecarlo <name>";
+            delete bot;
+        }
+        else
+        {
+            this->grid->set_selecting(true);
+            this->adding = Player(arguments.substr(split + 1, std::string::npos));
+            delete this->adding_bot;
+            this->adding_bot = bot;
+            prompt << "Select a place for " << this->adding.get_name() << ", please!";
+            this->text_input_box->stop();
+        }
+    }
     else if (input == "start")
     {
         if (PlayerManager::pm->get_num_players() < 2)
@@ -251,68 +327,217 @@ void Game::command(std::string input)
 
 void Game::start()
 {
-    PlayerManager::pm->shuffle();
+    PlayerManager::pm->shuffle(this->grid->get_rng());
+    for (auto bot : this->bots)
+    {
+        bot.second->prepare(GridView(this->grid));
+    }
+    trigger_event(BOB_NEXTROUNDEVENT, 0, nullptr, nullptr);
 }
 
 void Game::next_turn()
 {
     if (this->started)
     {
-        pm->next_turn();
+        if (pm->next_turn())
+        {
+            trigger_event(BOB_NEXTROUNDEVENT, 0, nullptr, nullptr);
+        }
+        else
+        {
+            trigger_event(BOB_NEXTTURNEVENT, 0, nullptr, nullptr);
+        }
+    }
+}
+
+void Game::play_bot()
+{
+    Player &current = PlayerManager::pm->get_current();
+    for (auto bot : this->bots)
+    {
+        if (bot.first == current)
+        {
+            // the bot only decides, its moves are carried out here
+            GridView view(this->grid);
+            Deadline now = std::chrono::steady_clock::now();
+            Deadline turn_deadline = now + std::chrono::milliseconds(bot.second->get_budget());
+            for (uint32_t moves = 0; moves < Bot::MAX_MOVES_PER_TURN && now < turn_deadline; moves++)
+            {
+                BotMove move = bot.second->decide(view, current, now + (turn_deadline - now) / 2);
+                if (move.type == BotMove::EndTurn)
+                    break;
+                apply_move(this->grid, current, move);
+                now = std::chrono::steady_clock::now();
+            }
+            this->next_turn();
+            return;
+        }
     }
 }
 
 int Game::game_loop()
 {
     this->frame_timer->start_timer();
-    this->move_timer->start_timer();
-    double fps;
-    Uint32 frame_counter = 0;
+    Uint32 next_tick = SDL_GetTicks();
+    Uint32 next_frame = next_tick;
     while (!this->quit)
     {
-        if (this->move_timer->get_timer() > 1)
+        SDL_Event event;
+        while (SDL_PollEvent(&event))
+        {
+            this->handle_event(&event);
+        }
+        Uint32 now = SDL_GetTicks();
+        // panning moves the same distance per second regardless of the frame rate
+        bool animating = this->move[0] || this->move[1] || this->move[2] || this->move[3];
+        if (!animating)
         {
-            this->move_timer->reset_timer();
-            SDL_Point move_by = {(this->move[1] - this->move[3]) * 20, (this->move[0] - this->move[2]) * 20};
-            if (move[0] || move[1] || move[2] || move[3])
+            next_tick = now;
+        }
+        for (Uint32 ticks = 0; animating && SDL_TICKS_PASSED(now, next_tick); ticks++)
+        {
+            if (ticks == MAX_TICKS_PER_FRAME)
             {
-                this->grid->move(move_by);
+                next_tick = now;
+                break;
             }
+            SDL_Point move_by = {(this->move[1] - this->move[3]) * PAN_STEP,
+                                 (this->move[0] - this->move[2]) * PAN_STEP};
+            this->grid->move(move_by);
+            next_tick += 1000 / TICK_RATE;
         }
-        if (this->frame_timer->get_timer() > 255)
+        // the grid's notifications are delivered in one batch per frame, right before it is drawn,
+        // without damage nothing is presented and the next frame may follow right away
+        if (SDL_TICKS_PASSED(now, next_frame))
         {
-            fps = frame_counter / (this->frame_timer->reset_timer() / 1000.0);
-            std::cout << fps << std::endl;
-            frame_counter = 0;
+            this->grid->flush_events();
+            if (this->render())
+                next_frame = now + 1000 / FRAME_RATE;
         }
-        SDL_Event event;
-        while (SDL_PollEvent(&event))
+        if (this->frame_timer->get_timer() > 255 && this->profile_box->get_visible())
+        {
+            this->frame_timer->reset_timer();
+            this->update_profile_box();
+        }
+        // sleep until the next frame or tick is due, or an event arrives
+        now = SDL_GetTicks();
+        Uint32 wake = animating ? next_tick : now + IDLE_TIMEOUT;
+        if (!SDL_TICKS_PASSED(now, next_frame) && SDL_TICKS_PASSED(wake, next_frame))
+        {
+            wake = next_frame;
+        }
+        if (!SDL_TICKS_PASSED(now, wake) && SDL_WaitEventTimeout(&event, wake - now))
         {
             this->handle_event(&event);
         }
-        this->render();
-        frame_counter++;
     }
     this->renderer->clear();
     return 0;
 }
 
-void Game::render()
+void Game::update_profile_box()
+{
+    std::ostringstream text;
+    text.precision(2);
+    text << std::fixed << "ms p50 p95 p99 max";
+    for (Profiler::Summary &summary : Profiler::profiler->summarize())
+    {
+        text << "\n" << summary.section << " " << summary.p50 << " " << summary.p95 << " " << summary.p99 << " "
+        << summary.max;
+    }
+    SDL_Point window_size = this->window->get_size();
+    this->profile_box->update_position({window_size.x - this->profile_box->get_dimensions().w - 20, 40});
+    this->profile_box->load_text(text.str());
+}
+
+void Game::scroll_frame()
+{
+    // the part of the scrolled area that stays in it moves by the offset
+    SDL_Rect area = this->damage.get_scroll_area();
+    SDL_Point scrolled = this->damage.get_scrolled();
+    SDL_Rect moved = {area.x + scrolled.x, area.y + scrolled.y, area.w, area.h};
+    SDL_Rect target;
+    if (!SDL_IntersectRect(&area, &moved, &target))
+        return;
+    if (this->frame_scratch == nullptr)
+    {
+        this->frame_scratch = SDL_CreateTexture(this->renderer->get_renderer(), SDL_PIXELFORMAT_RGBA8888,
+                                                SDL_TEXTUREACCESS_TARGET, this->frame_size.x, this->frame_size.y);
+        if (this->frame_scratch == nullptr)
+        {
+            throw SDL_TextureException();
+        }
+        SDL_SetTextureBlendMode(this->frame_scratch, SDL_BLENDMODE_NONE);
+    }
+    SDL_Rect source = {target.x - scrolled.x, target.y - scrolled.y, target.w, target.h};
+    this->renderer->set_target(this->frame_scratch);
+    this->renderer->copy(this->frame, &source, &target);
+    this->renderer->set_target(this->frame);
+    this->renderer->copy(this->frame_scratch, &target, &target);
+    this->renderer->set_target(nullptr);
+}
+
+bool Game::render()
 {
     try
     {
-        this->renderer->set_draw_color({0x0, 0x0, 0x0, 0xff});
-        this->renderer->clear();
-        this->grid->render(this->renderer);
-        this->field_box->render(this->renderer);
-        this->upgrade_box->render(this->renderer);
-        this->text_input_box->render(this->renderer);
+        this->damage.clear();
+        this->grid->prepare(&(this->damage));
+        // when the glyph atlas runs full, the boxes prepared before lay out their text again before any renders
+        this->glyphs->begin_frame();
+        Uint32 generation;
+        do
+        {
+            generation = this->glyphs->get_generation();
+            this->field_box->prepare(&(this->damage));
+            this->upgrade_box->prepare(&(this->damage));
+            this->text_input_box->prepare(&(this->damage));
+            this->profile_box->prepare(&(this->damage));
+        } while (generation != this->glyphs->get_generation());
+        SDL_Point window_size = this->window->get_size();
+        if (this->frame == nullptr || this->frame_size.x != window_size.x || this->frame_size.y != window_size.y)
+        {
+            SDL_DestroyTexture(this->frame);
+            SDL_DestroyTexture(this->frame_scratch);
+            this->frame_scratch = nullptr;
+            this->frame = SDL_CreateTexture(this->renderer->get_renderer(), SDL_PIXELFORMAT_RGBA8888,
+                                            SDL_TEXTUREACCESS_TARGET, window_size.x, window_size.y);
+            if (this->frame == nullptr)
+            {
+                throw SDL_TextureException();
+            }
+            this->frame_size = window_size;
+            this->damage.add({0, 0, window_size.x, window_size.y});
+        }
+        if (this->damage.empty())
+        {
+            return false;
+        }
+        this->scroll_frame();
+        // everything overlapping a damaged area is drawn again, clipped to it
+        this->renderer->set_target(this->frame);
+        for (SDL_Rect area : this->damage.get_rects())
+        {
+            this->renderer->set_clip_rect(&area);
+            this->renderer->set_draw_color({0x0, 0x0, 0x0, 0xff});
+            this->renderer->fill_rect(&area);
+            this->grid->render(this->renderer);
+            this->field_box->render(this->renderer);
+            this->upgrade_box->render(this->renderer);
+            this->text_input_box->render(this->renderer);
+            this->profile_box->render(this->renderer);
+        }
+        this->renderer->set_clip_rect(nullptr);
+        this->renderer->set_target(nullptr);
+        this->renderer->copy(this->frame, nullptr, nullptr);
         this->renderer->present();
+        Profiler::profiler->end_frame();
     }
     catch (const SDL_RendererException &err)
     {
         std::cerr << "Failed to render: " << err.what() << std::endl;
     }
+    return true;
 }
 
 void init_sdl(Uint32 flags)
@@ -331,9 +556,13 @@ void init_ttf()
     }
 }
 
-int main(int, char **)
+int main(int argc, char **argv)
 {
+    // a game can be replayed by passing the seed it printed
+    uint64_t seed = (argc > 1) ? std::stoull(argv[1]) : std::random_device()();
+    std::cout << "Seed: " << seed << std::endl;
     PlayerManager::init();
+    Profiler::init();
     try
     {
         init_sdl(SDL_INIT_VIDEO);
@@ -348,11 +577,12 @@ int main(int, char **)
     SDL_GetDisplayBounds(0, &bounds);
     SDL_Rect window_dimensions = {SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 600, 600};
     int exit_status = 1;
-    Game *game = new Game(&window_dimensions, 10, PlayerManager::pm);
+    Game *game = new Game(&window_dimensions, 10, PlayerManager::pm, seed);
     exit_status = game->game_loop();
     delete game;
     SDL_Quit();
     PlayerManager::destroy();
+    Profiler::destroy();
     TTF_Quit();
     return exit_status;
 }
\ No newline at end of file
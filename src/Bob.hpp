@@ -2,6 +2,7 @@
 #define _BOB_H
 
 #include <iostream>
+#include <fstream>
 #include <string>
 #include <utility>
 #include <SDL2/SDL.h>
@@ -11,17 +12,27 @@
 #include "Gameplay.hpp"
 #include "Events.hpp"
 #include "Gui.hpp"
+#include "Bots.hpp"
+#include "Profiler.hpp"
 
 const std::string TITLE = "Bob - Battles of Bacteria";
 
+const uint32_t BOT_BUDGET = 250; // milliseconds per bot turn
+const Uint32 FRAME_RATE = 60; // frames per second at most
+const Uint32 TICK_RATE = 60; // fixed steps per second for the input driven updates, like panning
+const Uint32 MAX_TICKS_PER_FRAME = 5; // ticks beyond are dropped after a stall instead of caught up
+const int PAN_STEP = 20; // pixels per tick
+const Uint32 IDLE_TIMEOUT = 250; // milliseconds to sleep at most when nothing is animating
+
 class Game
 {
 
 public:
-    Game(SDL_Rect *window_dimensions, Sint16 size, PlayerManager *pm)
+    Game(SDL_Rect *window_dimensions, Sint16 size, PlayerManager *pm, uint64_t seed)
             : pm(pm)
     {
         this->adding = pm->default_player;
+        this->adding_bot = nullptr;
         this->started = false;
         this->layout = new Layout(pointy_orientation, 20,
                                   {window_dimensions->w / 2, window_dimensions->h / 2},
@@ -31,7 +42,11 @@ public:
             this->move[i] = false;
         }
         this->quit = false;
+        this->frame = nullptr;
+        this->frame_scratch = nullptr;
+        this->frame_size = {0, 0};
         SDL_Color fg = {0x00, 0x00, 0x00, 0xff};
+        this->bus = new EventBus();
         try
         {
             this->font = load_font_from_file("/usr/share/fonts/dejavu/DejaVuSans.ttf", 20);
@@ -39,20 +54,27 @@ public:
             SDL_Point window_size = this->window->get_size();
             this->renderer = new Renderer(this->window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC
                                                             | SDL_RENDERER_TARGETTEXTURE);
-            this->grid = new HexagonGrid(size, this->layout, this->renderer);
+            this->grid = new HexagonGrid(size, this->layout, this->renderer, this->bus, seed);
+            this->glyphs = new GlyphAtlas(this->renderer);
             FieldMeta *center = this->grid->get_field({0, 0, 0});
-            this->field_box = new FieldBox(this->renderer, {0, 0, 200, 100}, fg, this->font, center);
-            this->upgrade_box = new UpgradeBox(this->renderer, {0, 0, 200, 20}, fg, this->font, center);
+            this->field_box = new FieldBox(this->renderer, {0, 0, 200, 100}, fg, this->font, this->glyphs, this->bus,
+                                           center);
+            this->upgrade_box = new UpgradeBox(this->renderer, {0, 0, 200, 20}, fg, this->font, this->glyphs,
+                                               this->bus, center);
             int font_height = TTF_FontHeight(this->font);
-            this->text_input_box = new TextInputBox(this->renderer, {0, 0, window_size.x, font_height}, fg, this->font);
+            this->text_input_box = new TextInputBox(this->renderer, {0, 0, window_size.x, font_height}, fg, this->font,
+                                                    this->glyphs);
             this->text_input_box->stop();
+            this->profile_box = new TextBox(this->renderer, {window_size.x - 320, 40, 300, font_height}, fg,
+                                            this->font, this->glyphs);
         }
         catch (const SDL_Exception &sdl_except)
         {
             std::cerr << sdl_except.what() << " happened when constructing game" << std::endl;
         }
+        this->bus->subscribe<MarkerMoved>([this](const MarkerMoved &event) { this->marker_moved(event); });
+        this->bus->subscribe<FieldSelected>([this](const FieldSelected &event) { this->field_selected(event); });
         this->frame_timer = new Timer();
-        this->move_timer = new Timer();
         //Player::current_player = this->players[turn];
     }
 
@@ -62,15 +84,24 @@ public:
         {
             delete player;
         }*/
+        for (auto bot : this->bots)
+        {
+            delete bot.second;
+        }
+        delete this->adding_bot;
         delete text_input_box;
+        delete this->profile_box;
         delete this->upgrade_box;
         delete this->field_box;
-        delete this->move_timer;
+        delete this->glyphs;
+        SDL_DestroyTexture(this->frame);
+        SDL_DestroyTexture(this->frame_scratch);
         delete this->frame_timer;
         delete this->grid;
         delete this->renderer;
         delete this->window;
         delete this->layout;
+        delete this->bus;
     }
 
     PlayerManager *get_player_manager()
@@ -82,31 +113,50 @@ public:
 
     void command(std::string command);
 
-    void render();
+    // redraws the damaged areas of the frame, false if nothing changed and no frame was presented
+    bool render();
 
     void handle_event(SDL_Event *event);
 
+    void marker_moved(const MarkerMoved &event);
+
+    void field_selected(const FieldSelected &event);
+
     int game_loop();
 
     void next_turn();
 
+    // lets a bot play the turn of the current player, if it is one
+    void play_bot();
+
 private:
     bool started;
     Player adding;
+    Bot *adding_bot; // bot for the player being added, nullptr for a human
+    std::vector<std::pair<Player, Bot *>> bots;
     TextInputBox *text_input_box;
+    TextBox *profile_box; // percentiles of the frame times, toggled by the profile command
+    void update_profile_box();
     //std::vector<Player *> players;
     PlayerManager *pm;
     UpgradeBox *upgrade_box;
     FieldBox *field_box;
     TTF_Font *font;
+    GlyphAtlas *glyphs;
     Window *window;
     Renderer *renderer;
+    EventBus *bus; // notifications of the grid, SDL events are left to input and turns
+    // the composited frame, the back buffer isn't kept between frames
+    SDL_Texture *frame;
+    SDL_Texture *frame_scratch; // a texture can't be copied onto itself, scrolling the frame goes through this one
+    SDL_Point frame_size;
+    void scroll_frame();
+    Damage damage;
     HexagonGrid *grid;
     Layout *layout;
     bool move[4];
     bool quit;
     Timer *frame_timer;
-    Timer *move_timer;
 };
 
 #endif
@@ -0,0 +1,247 @@
+#include "Bots.hpp"
+
+int32_t GridView::get_neighbor(uint32_t index, uint8_t direction) const
+{
+    FieldMeta *neighbor = this->grid->get_field(index)->get_neighbor(direction);
+    if (neighbor == nullptr)
+        return -1;
+    return (int32_t) this->grid->get_index(neighbor);
+}
+
+Resource GridView::get_resources_of_cluster(uint32_t index) const
+{
+    // may bring the cached sum of the cluster up to date, the game stays the same
+    return this->grid->get_resources_of_cluster(this->grid->get_cluster(this->grid->get_field(index)));
+}
+
+bool GridView::assess_fight(Player &player, uint32_t index, Resource *costs) const
+{
+    std::vector<Cluster *> attackers_clusters;
+    return player.assess_fight(this->grid->get_field(index), costs, &attackers_clusters);
+}
+
+// lowest level of the upgrade line starting with first that has not been bought yet
+static bool next_upgrade(const GridView &view, uint32_t index, Upgrade first, Upgrade *next)
+{
+    UpgradeFlags upgrades = view.get_upgrades(index);
+    for (int level = 0; level < 3; level++)
+    {
+        if (!upgrades[first + level])
+        {
+            *next = (Upgrade) (first + level);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool can_afford(const GridView &view, uint32_t index, Upgrade upgrade)
+{
+    return UPGRADE_COSTS.at(upgrade) <= view.get_resources_of_cluster(index);
+}
+
+std::vector<BotMove> generate_moves(const GridView &view, Player &player)
+{
+    std::vector<BotMove> moves;
+    moves.push_back({BotMove::EndTurn, 0, Regeneration_1});
+    PlayerId id = view.find(player);
+    // everything a player can act on lies on its frontier
+    std::vector<uint32_t> targets;
+    for (uint32_t index : view.get_frontier(id))
+    {
+        bool border = false; // an enemy field touches the field, default fields don't count
+        for (uint8_t i = 0; i < 6; i++)
+        {
+            int32_t neighbor = view.get_neighbor(index, i);
+            if (neighbor < 0 || view.get_owner((uint32_t) neighbor) == id || view.get_owner((uint32_t) neighbor) == 0)
+                continue;
+            border = true;
+            targets.push_back((uint32_t) neighbor);
+        }
+        // reproduction is taken from the neighbor that is grown into, so only these lines pay off
+        Upgrade upgrade;
+        if (view.get_resources_base(index) != Resource({0, 0, 0}) && next_upgrade(view, index, Regeneration_1, &upgrade)
+            && can_afford(view, index, upgrade))
+            moves.push_back({BotMove::BuyUpgrade, index, upgrade});
+        if (border)
+        {
+            if (next_upgrade(view, index, Offense_1, &upgrade) && can_afford(view, index, upgrade))
+                moves.push_back({BotMove::BuyUpgrade, index, upgrade});
+            if (next_upgrade(view, index, Defense_1, &upgrade) && can_afford(view, index, upgrade))
+                moves.push_back({BotMove::BuyUpgrade, index, upgrade});
+        }
+    }
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+    for (uint32_t index : targets)
+    {
+        Resource costs;
+        if (view.assess_fight(player, index, &costs))
+            moves.push_back({BotMove::Attack, index, Regeneration_1});
+    }
+    return moves;
+}
+
+void apply_move(Grid *grid, Player &player, BotMove move)
+{
+    FieldMeta *meta = grid->get_field(move.field);
+    switch (move.type)
+    {
+        case BotMove::Attack:
+            player.fight(meta);
+            break;
+        case BotMove::BuyUpgrade:
+            meta->upgrade(move.upgrade);
+            break;
+        default:
+            break;
+    }
+}
+
+BotMove GreedyBot::decide(const GridView &view, Player &player, Deadline deadline)
+{
+    std::vector<BotMove> moves = generate_moves(view, player);
+    BotMove best = moves.front();
+    uint32_t best_costs = 0;
+    for (BotMove &move : moves)
+    {
+        if (std::chrono::steady_clock::now() >= deadline)
+            break;
+        if (move.type == BotMove::Attack)
+        {
+            // conquering is always worth more than upgrading, take the cheapest fight
+            Resource costs;
+            view.assess_fight(player, move.field, &costs);
+            if (best.type != BotMove::Attack || costs.circle < best_costs)
+            {
+                best = move;
+                best_costs = costs.circle;
+            }
+        }
+        else if (move.type == BotMove::BuyUpgrade && best.type == BotMove::EndTurn)
+        {
+            best = move;
+        }
+        else if (move.type == BotMove::BuyUpgrade && best.type == BotMove::BuyUpgrade)
+        {
+            // cheaper upgrades first, regeneration before offense before defense
+            if (UPGRADE_COSTS.at(move.upgrade) < UPGRADE_COSTS.at(best.upgrade))
+                best = move;
+        }
+    }
+    return best;
+}
+
+double MonteCarloBot::rollout(Player &player, std::vector<Player> &opponents, BotMove move)
+{
+    Grid &copy = *(this->scratch);
+    copy.begin_journal();
+    // every rollout plays a different future
+    copy.get_rng().seed(this->rng(), this->rng());
+    apply_move(&copy, player, move);
+    // reproduction doesn't depend on resources and the score only counts fields, so regeneration is left out
+    for (uint32_t round = 0; round < this->depth; round++)
+    {
+        copy.reproduce(player);
+        for (Player &opponent : opponents)
+        {
+            copy.reproduce(opponent);
+        }
+    }
+    // own fields against the strongest opponent
+    double best_opponent = 0;
+    for (Player &opponent : opponents)
+    {
+        best_opponent = std::max(best_opponent, (double) copy.count_fields(opponent));
+    }
+    double score = copy.count_fields(player) - best_opponent;
+    copy.rollback();
+    return score;
+}
+
+void MonteCarloBot::prepare(const GridView &view)
+{
+    this->scratch.reset(view.copy());
+}
+
+BotMove MonteCarloBot::decide(const GridView &view, Player &player, Deadline deadline)
+{
+    std::vector<BotMove> moves = generate_moves(view, player);
+    if (moves.size() == 1)
+        return moves.front();
+    // the players still on the grid, without the default player and the player itself
+    std::vector<Player> opponents;
+    PlayerId id = view.find(player);
+    for (PlayerId opponent = 1; opponent < view.get_num_players(); opponent++)
+    {
+        if (opponent != id && !view.get_frontier(opponent).empty())
+            opponents.push_back(view.get_player(opponent));
+    }
+    // following the grid counts against the budget too, assuming it takes as long as last time,
+    // without the time for it and a rollout the turn ends and the next decision tries with less
+    Deadline now = std::chrono::steady_clock::now();
+    if (now + this->sync_time + this->rollout_time >= deadline)
+    {
+        this->sync_time /= 2;
+        this->rollout_time /= 2;
+        return moves.front();
+    }
+    if (this->scratch)
+        view.update(*(this->scratch));
+    else
+        this->prepare(view);
+    this->sync_time = std::chrono::steady_clock::now() - now;
+    // play the moves in turns until the time is up, so every move gets about the same number of rollouts,
+    // a rollout is only started if it ends in time, assuming it takes as long as the slowest one so far,
+    // the first one is judged by the last decision
+    std::vector<double> scores(moves.size(), 0);
+    std::vector<uint32_t> rollouts(moves.size(), 0);
+    std::chrono::steady_clock::duration slowest(0);
+    bool running = true;
+    while (running)
+    {
+        for (uint32_t i = 0; i < moves.size(); i++)
+        {
+            Deadline start = std::chrono::steady_clock::now();
+            if (start + std::max(slowest, this->rollout_time) >= deadline)
+            {
+                running = false;
+                break;
+            }
+            scores[i] += this->rollout(player, opponents, moves[i]);
+            rollouts[i]++;
+            slowest = std::max(slowest, std::chrono::steady_clock::now() - start);
+        }
+    }
+    // without a single rollout the next decision tries with less
+    if (rollouts.front() > 0)
+        this->rollout_time = slowest;
+    else
+        this->rollout_time /= 2;
+    // moves without a single rollout are not considered, without any rollout the turn ends
+    BotMove best = moves.front();
+    double best_score = 0;
+    bool found = false;
+    for (uint32_t i = 0; i < moves.size(); i++)
+    {
+        if (rollouts[i] == 0)
+            continue;
+        double score = scores[i] / rollouts[i];
+        if (!found || score > best_score)
+        {
+            best = moves[i];
+            best_score = score;
+            found = true;
+        }
+    }
+    return best;
+}
+
+Bot *create_bot(std::string type, uint32_t budget, uint64_t seed, uint64_t stream)
+{
+    if (type == "greedy")
+        return new GreedyBot(budget);
+    if (type == "montecarlo")
+        return new MonteCarloBot(budget, 3, seed, stream);
+    return nullptr;
+}
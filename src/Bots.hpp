@@ -0,0 +1,128 @@
+#ifndef _BOTS_H
+#define _BOTS_H
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Simulation.hpp"
+
+typedef std::chrono::steady_clock::time_point Deadline;
+
+struct BotMove
+{
+    enum Type
+    {
+        EndTurn,
+        Attack,
+        BuyUpgrade
+    };
+
+    Type type;
+    uint32_t field; // index of the targeted field in the grid
+    Upgrade upgrade;
+};
+
+// what a bot may see of the game, fields are referred to by their index in the grid
+class GridView
+{
+public:
+    GridView(Grid *grid_)
+            : grid(grid_) { }
+
+    uint32_t get_num_fields() const { return this->grid->get_num_fields(); }
+
+    PlayerId get_owner(uint32_t index) const { return this->grid->get_field(index)->get_owner_id(); }
+
+    // -1 if the direction leads off the grid
+    int32_t get_neighbor(uint32_t index, uint8_t direction) const;
+
+    UpgradeFlags get_upgrades(uint32_t index) const { return this->grid->get_field(index)->get_upgrades(); }
+
+    Resource get_resources_base(uint32_t index) const { return this->grid->get_field(index)->get_resources_base(); }
+
+    // of the cluster the field belongs to
+    Resource get_resources_of_cluster(uint32_t index) const;
+
+    const std::vector<uint32_t> &get_frontier(PlayerId owner) const { return this->grid->get_frontier(owner); }
+
+    bool assess_fight(Player &player, uint32_t index, Resource *costs) const;
+
+    PlayerId find(const Player &player) const { return this->grid->get_players()->find(player); }
+
+    size_t get_num_players() const { return this->grid->get_players()->size(); }
+
+    Player get_player(PlayerId id) const { return this->grid->get_players()->get(id); }
+
+    // for playing ahead on a grid of the bot's own, an update only takes over what changed since the last one
+    Grid *copy() const { return new Grid(*(this->grid)); }
+
+    void update(Grid &copy) const { copy.follow(*(this->grid)); }
+
+private:
+    Grid *grid;
+};
+
+// computer player, looks at the grid and decides on the next move of its player,
+// the moves are carried out by whoever runs the turn
+class Bot
+{
+public:
+    Bot(uint32_t budget_)
+            : budget(budget_) { }
+
+    virtual ~Bot() { }
+
+    // once the players are placed, before the first turn and outside of the budget
+    virtual void prepare(const GridView &) { }
+
+    virtual BotMove decide(const GridView &view, Player &player, Deadline deadline) = 0;
+
+    // milliseconds per turn, every decision may use half of the time left
+    uint32_t get_budget() { return this->budget; }
+
+    static const uint32_t MAX_MOVES_PER_TURN = 64;
+protected:
+    uint32_t budget;
+};
+
+// attacks the cheapest field it can win, otherwise buys the cheapest useful upgrade
+class GreedyBot : public Bot
+{
+public:
+    GreedyBot(uint32_t budget_)
+            : Bot(budget_) { }
+
+    BotMove decide(const GridView &view, Player &player, Deadline deadline);
+};
+
+// compares the candidate moves by playing the following rounds on a copy of the grid,
+// every rollout is taken back by the copy's journal
+class MonteCarloBot : public Bot
+{
+public:
+    MonteCarloBot(uint32_t budget_, uint32_t depth_, uint64_t seed, uint64_t stream)
+            : Bot(budget_), depth(depth_), rng(seed, stream), sync_time(0), rollout_time(0) { }
+
+    void prepare(const GridView &view);
+
+    BotMove decide(const GridView &view, Player &player, Deadline deadline);
+
+private:
+    uint32_t depth; // rounds played per rollout
+    Pcg32 rng; // seeds the rollouts
+    std::unique_ptr<Grid> scratch; // follows the grid of the game
+    std::chrono::steady_clock::duration sync_time; // it took to follow the grid for the last decision
+    std::chrono::steady_clock::duration rollout_time; // of the slowest rollout of the last decision
+    double rollout(Player &player, std::vector<Player> &opponents, BotMove move);
+};
+
+// all moves the player could make this turn around its frontier, ending the turn first
+std::vector<BotMove> generate_moves(const GridView &view, Player &player);
+
+void apply_move(Grid *grid, Player &player, BotMove move);
+
+// "greedy" or "montecarlo", nullptr for an unknown type
+Bot *create_bot(std::string type, uint32_t budget, uint64_t seed = 0, uint64_t stream = 0);
+
+#endif
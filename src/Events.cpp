@@ -1,10 +1,6 @@
 #include "Events.hpp"
 
 const Uint32 BOB_NEXTROUNDEVENT = register_events(1);
-const Uint32 BOB_MARKERUPDATE = register_events(1);
-const Uint32 BOB_FIELDUPDATEEVENT = register_events(1);
-const Uint32 BOB_FIELDSELECTEDEVENT = register_events(1);
-const Uint32 BOB_FIELDUPGRADEVENT = register_events(1);
 const Uint32 BOB_NEXTTURNEVENT = register_events(1);
 const Uint32 BOB_ATTACKEVENT = register_events(1);
 const Uint32 BOB_PLAYERADDED = register_events(1);
@@ -37,8 +33,22 @@ Uint32 register_events(Uint32 n)
     return base_event;
 }
 
+const char *event_name(Uint32 type)
+{
+    if (type == BOB_NEXTROUNDEVENT)
+        return "BOB_NEXTROUNDEVENT";
+    if (type == BOB_NEXTTURNEVENT)
+        return "BOB_NEXTTURNEVENT";
+    if (type == BOB_ATTACKEVENT)
+        return "BOB_ATTACKEVENT";
+    if (type == BOB_PLAYERADDED)
+        return "BOB_PLAYERADDED";
+    return nullptr;
+}
+
 void trigger_event(Uint32 type, Sint32 code, void *data1, void *data2)
 {
+    TraceSpan span(event_name(type), "trigger_event");
     SDL_Event event;
     SDL_memset(&event, 0, sizeof(event)); /* or SDL_zero(event) */
     event.type = type;
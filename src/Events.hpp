@@ -3,15 +3,16 @@
 
 #include <SDL2/SDL.h>
 #include <boost/uuid/uuid.hpp>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <vector>
 #include "Exceptions.hpp"
+#include "Trace.hpp"
 
 #ifndef _EVENT_TYPES
 #define _EVENT_TYPES
 extern const Uint32 BOB_NEXTROUNDEVENT;
-extern const Uint32 BOB_MARKERUPDATE;
-extern const Uint32 BOB_FIELDUPDATEEVENT;
-extern const Uint32 BOB_FIELDSELECTEDEVENT;
-extern const Uint32 BOB_FIELDUPGRADEVENT;
 extern const Uint32 BOB_NEXTTURNEVENT;
 extern const Uint32 BOB_ATTACKEVENT;
 extern const Uint32 BOB_PLAYERADDED;
@@ -19,6 +20,9 @@ extern const Uint32 BOB_PLAYERADDED;
 
 Uint32 register_events(Uint32 n);
 
+// name of one of the event types above for traces, nullptr for the others
+const char *event_name(Uint32 type);
+
 class Timer
 {
 private:
@@ -48,4 +52,222 @@ struct FieldUpdate
 
 void trigger_event(Uint32 type, Sint32 code, void *data1, void *data2);
 
+// typed publish/subscribe in the game's thread, every event type is a topic with its own subscribers,
+// subscribers of a single cell only get the events published for that cell,
+// events are delivered right away, handlers may publish, subscribe and unsubscribe themselves
+// an event type needs a static name() for traces
+class EventBus
+{
+public:
+    typedef Uint64 Subscription;
+
+    EventBus()
+            : next_subscription(1), delivering(0) { }
+
+    ~EventBus()
+    {
+        for (TopicBase *topic : this->topics)
+        {
+            delete topic;
+        }
+    }
+
+    // every event of the type
+    template<typename Event>
+    Subscription subscribe(std::function<void(const Event &)> handler)
+    {
+        Topic<Event> *topic = this->topic<Event>();
+        return this->add(&(topic->all), handler, {topic_id<Event>(), false, 0});
+    }
+
+    // only the events of the type published for cell
+    template<typename Event>
+    Subscription subscribe(Uint32 cell, std::function<void(const Event &)> handler)
+    {
+        Topic<Event> *topic = this->topic<Event>();
+        return this->add(&(topic->cells[cell]), handler, {topic_id<Event>(), true, cell});
+    }
+
+    // cells with subscribers of the type, a batch of cells only has to be delivered to these
+    template<typename Event>
+    std::vector<Uint32> watched_cells()
+    {
+        std::vector<Uint32> cells;
+        for (auto &entry : this->topic<Event>()->cells)
+        {
+            cells.push_back(entry.first);
+        }
+        return cells;
+    }
+
+    // unknown subscriptions, like 0, are ignored
+    void unsubscribe(Subscription subscription)
+    {
+        auto found = this->locations.find(subscription);
+        if (found == this->locations.end())
+            return;
+        bool erase = this->delivering == 0;
+        this->topics[found->second.topic]->remove(subscription, found->second, erase);
+        if (!erase)
+            this->removed.push_back(found->second);
+        this->locations.erase(found);
+    }
+
+    template<typename Event>
+    void publish(const Event &event)
+    {
+        TraceSpan span(Event::name(), "publish");
+        this->deliver(&(this->topic<Event>()->all), event);
+    }
+
+    // to the subscribers of the whole topic and those of cell
+    template<typename Event>
+    void publish(Uint32 cell, const Event &event)
+    {
+        TraceSpan span(Event::name(), "publish");
+        Topic<Event> *topic = this->topic<Event>();
+        this->deliver(&(topic->all), event);
+        auto found = topic->cells.find(cell);
+        if (found != topic->cells.end())
+            this->deliver(&(found->second), event);
+    }
+
+private:
+    struct Location
+    {
+        size_t topic;
+        bool targeted;
+        Uint32 cell;
+    };
+
+    struct TopicBase
+    {
+        virtual ~TopicBase() { }
+
+        // while delivering the subscriber only loses its handler, the list is left alone
+        virtual void remove(Subscription subscription, const Location &location, bool erase) = 0;
+
+        // drops the subscribers without handler from the list of location, and the list of a cell once it's empty
+        virtual void compact(const Location &location) = 0;
+    };
+
+    template<typename Event>
+    struct Subscriber
+    {
+        Subscription id;
+        std::function<void(const Event &)> handler;
+    };
+
+    template<typename Event>
+    struct Topic : TopicBase
+    {
+        std::vector<Subscriber<Event>> all;
+        std::unordered_map<Uint32, std::vector<Subscriber<Event>>> cells;
+
+        void remove(Subscription subscription, const Location &location, bool erase)
+        {
+            auto list_found = this->cells.end();
+            std::vector<Subscriber<Event>> *list = &(this->all);
+            if (location.targeted)
+            {
+                list_found = this->cells.find(location.cell);
+                list = &(list_found->second);
+            }
+            for (size_t i = 0; i < list->size(); i++)
+            {
+                if ((*list)[i].id != subscription)
+                    continue;
+                if (erase)
+                    list->erase(list->begin() + i);
+                else
+                    (*list)[i].handler = nullptr;
+                break;
+            }
+            if (erase && location.targeted && list->empty())
+                this->cells.erase(list_found);
+        }
+
+        void compact(const Location &location)
+        {
+            auto list_found = this->cells.end();
+            std::vector<Subscriber<Event>> *list = &(this->all);
+            if (location.targeted)
+            {
+                list_found = this->cells.find(location.cell);
+                if (list_found == this->cells.end()) // compacted already
+                    return;
+                list = &(list_found->second);
+            }
+            list->erase(std::remove_if(list->begin(), list->end(),
+                                       [](const Subscriber<Event> &subscriber) { return !subscriber.handler; }),
+                        list->end());
+            if (location.targeted && list->empty())
+                this->cells.erase(list_found);
+        }
+    };
+
+    std::vector<TopicBase *> topics;
+    std::unordered_map<Subscription, Location> locations;
+    Subscription next_subscription;
+    Uint32 delivering; // nesting depth of publish
+    std::vector<Location> removed; // lists with subscribers removed while delivering, compacted afterwards
+
+    static size_t next_topic_id()
+    {
+        static size_t next = 0;
+        return next++;
+    }
+
+    template<typename Event>
+    static size_t topic_id()
+    {
+        static size_t id = next_topic_id();
+        return id;
+    }
+
+    template<typename Event>
+    Topic<Event> *topic()
+    {
+        size_t id = topic_id<Event>();
+        if (this->topics.size() <= id)
+            this->topics.resize(id + 1, nullptr);
+        if (this->topics[id] == nullptr)
+            this->topics[id] = new Topic<Event>();
+        return static_cast<Topic<Event> *>(this->topics[id]);
+    }
+
+    template<typename Event>
+    Subscription add(std::vector<Subscriber<Event>> *list, std::function<void(const Event &)> handler,
+                     Location location)
+    {
+        Subscription subscription = this->next_subscription++;
+        list->push_back({subscription, handler});
+        this->locations[subscription] = location;
+        return subscription;
+    }
+
+    template<typename Event>
+    void deliver(std::vector<Subscriber<Event>> *list, const Event &event)
+    {
+        this->delivering++;
+        // subscribers added by the handlers get the next event, the list may grow meanwhile
+        size_t count = list->size();
+        for (size_t i = 0; i < count; i++)
+        {
+            std::function<void(const Event &)> handler = (*list)[i].handler;
+            if (handler)
+                handler(event);
+        }
+        this->delivering--;
+        if (this->delivering == 0 && !this->removed.empty())
+        {
+            for (const Location &location : this->removed)
+            {
+                this->topics[location.topic]->compact(location);
+            }
+            this->removed.clear();
+        }
+    }
+};
+
 #endif
\ No newline at end of file
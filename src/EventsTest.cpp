@@ -0,0 +1,80 @@
+#include <iostream>
+#include "Events.hpp"
+
+// stand-alone checks of the EventBus, returns the number of failed checks
+
+struct Hovered
+{
+    Uint32 cell;
+
+    static const char *name() { return "Hovered"; }
+};
+
+static int failures = 0;
+
+static void check(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::cerr << "failed: " << what << std::endl;
+        failures++;
+    }
+}
+
+// a subscriber of one cell that removes itself when its event arrives
+static void unsubscribe_while_delivering()
+{
+    EventBus bus;
+    EventBus::Subscription own = 0;
+    int calls = 0;
+    own = bus.subscribe<Hovered>(5, [&](const Hovered &) {
+        calls++;
+        bus.unsubscribe(own);
+    });
+    check(bus.watched_cells<Hovered>().size() == 1, "cell 5 watched after subscribing");
+    bus.publish(5, Hovered{5});
+    check(calls == 1, "handler called once");
+    check(bus.watched_cells<Hovered>().empty(), "cell 5 not watched after unsubscribing from its handler");
+    bus.publish(5, Hovered{5});
+    check(calls == 1, "handler not called after unsubscribing");
+}
+
+// a subscriber of the whole topic that removes one of a cell, the cell's list is dropped after delivery
+static void unsubscribe_other_while_delivering()
+{
+    EventBus bus;
+    int calls = 0;
+    EventBus::Subscription watcher = bus.subscribe<Hovered>(7, [&](const Hovered &) { calls++; });
+    bus.subscribe<Hovered>([&](const Hovered &) { bus.unsubscribe(watcher); });
+    bus.publish(3, Hovered{3});
+    check(bus.watched_cells<Hovered>().empty(), "cell 7 not watched after unsubscribing from another handler");
+    bus.publish(7, Hovered{7});
+    check(calls == 0, "removed cell subscriber not called");
+}
+
+// like the field box following the marker, the watched cells don't pile up with every cell hovered
+static void follow_while_delivering()
+{
+    EventBus bus;
+    EventBus::Subscription follower = 0;
+    bus.subscribe<Hovered>([&](const Hovered &hovered) {
+        bus.unsubscribe(follower);
+        follower = bus.subscribe<Hovered>(hovered.cell, [](const Hovered &) { });
+    });
+    for (Uint32 cell = 0; cell < 100; cell++)
+    {
+        bus.publish(Hovered{cell});
+    }
+    std::vector<Uint32> watched = bus.watched_cells<Hovered>();
+    check(watched.size() == 1 && watched[0] == 99, "only the last hovered cell watched");
+}
+
+int main()
+{
+    unsubscribe_while_delivering();
+    unsubscribe_other_while_delivering();
+    follow_while_delivering();
+    if (failures == 0)
+        std::cout << "all checks passed" << std::endl;
+    return failures;
+}
@@ -1,7 +1,5 @@
 #include "Gameplay.hpp"
 
-PlayerManager *PlayerManager::pm = nullptr;
-
 SDL_Point operator+(SDL_Point left, SDL_Point right)
 {
     return {left.x + right.x, left.y + right.y};
@@ -45,47 +43,16 @@ double operator!(SDL_Point left)
     return length;
 }
 
-Field Field::cubic_round(double x, double y, double z)
-{
-    double round_x = std::round(x);
-    double round_y = std::round(y);
-    double round_z = std::round(z);
-    double x_err = std::abs(round_x - x);
-    double y_err = std::abs(round_y - y);
-    double z_err = std::abs(round_z - z);
-    if (x_err > y_err && x_err > z_err)
-    {
-        round_x = -round_y - round_z;
-    } else if (y_err > z_err)
-    {
-        round_y = -round_x - round_z;
-    } else
-    {
-        round_z = -round_x - round_y;
-    }
-    Sint16 x_out = (int) round_x;
-    Sint16 y_out = (int) round_y;
-    Sint16 z_out = (int) round_z;
-    return Field(x_out, y_out, z_out);
-}
-
-
-Field Field::hex_direction(Uint8 direction)
+SDL_Color to_sdl_color(Color color)
 {
-    assert (0 <= direction && direction <= 5);
-    return hex_directions[direction];
+    return {color.r, color.g, color.b, color.a};
 }
 
-Field Field::get_neighbor(Uint8 direction) const
-{
-    return hex_direction(direction) + *this;
-}
-
-Point Field::field_to_point(const Layout *layout) const
+Point field_to_point(const Field &field, const Layout *layout)
 {
     const Orientation m = layout->orientation;
-    double x = (m.f0 * this->x + m.f1 * this->y) * layout->size;
-    double y = (m.f2 * this->x + m.f3 * this->y) * layout->size;
+    double x = (m.f0 * field.x + m.f1 * field.y) * layout->size;
+    double y = (m.f2 * field.x + m.f3 * field.y) * layout->size;
     return {x + layout->origin.x, y + layout->origin.y};
 }
 
@@ -107,10 +74,10 @@ Point field_corner_offset(Uint8 corner, const Layout *layout)
     return {x, y};
 }
 
-std::vector<Point> Field::field_to_polygon(const Layout *layout) const
+std::vector<Point> field_to_polygon(const Field &field, const Layout *layout)
 {
-    std::vector<Point> corners = this->field_to_polygon_normalized(layout);
-    Point center = this->field_to_point(layout);
+    std::vector<Point> corners = field_to_polygon_normalized(field, layout);
+    Point center = field_to_point(field, layout);
     for (Point &p : corners)
     {
         p = p + center;
@@ -118,19 +85,19 @@ std::vector<Point> Field::field_to_polygon(const Layout *layout) const
     return corners;
 }
 
-std::vector<SDL_Point> Field::field_to_polygon_sdl(const Layout *layout) const
+std::vector<SDL_Point> field_to_polygon_sdl(const Field &field, const Layout *layout)
 {
     std::vector<SDL_Point> corners;
     for (uint8_t i = 0; i < 6; i++)
     {
-        Point center = this->field_to_point(layout);
+        Point center = field_to_point(field, layout);
         Point offset = field_corner_offset(i, layout);
         SDL_Point p;
         p.x = (int) offset.x + center.x;
         p.y = (int) offset.y + center.y;
         corners.push_back(p);
     }
-    Point center = this->field_to_point(layout);
+    Point center = field_to_point(field, layout);
     Point offset = field_corner_offset(0, layout);
     SDL_Point p;
     p.x = (int) offset.x + center.x;
@@ -139,7 +106,7 @@ std::vector<SDL_Point> Field::field_to_polygon_sdl(const Layout *layout) const
     return corners;
 }
 
-std::vector<Point> Field::field_to_polygon_normalized(const Layout *layout) const
+std::vector<Point> field_to_polygon_normalized(const Field &, const Layout *layout)
 {
     std::vector<Point> corners;
     for (uint8_t i = 0; i < 6; i++)
@@ -150,299 +117,827 @@ std::vector<Point> Field::field_to_polygon_normalized(const Layout *layout) cons
     return corners;
 }
 
-void FieldMeta::regenerate_resources()
+SDL_Rect HexagonGrid::sprite_rect(Sprite sprite)
 {
-    this->resources = resources_base;
-    if (this->upgrades[Regeneration_1])
-        this->resources *= 2;
-    if (this->upgrades[Regeneration_2])
-        this->resources *= 4;
-    if (this->upgrades[Regeneration_3])
-        this->resources *= 8;
-    trigger_event(BOB_FIELDUPDATEEVENT, 0, (void *) this, nullptr);
-    this->changed = true;
+    // three sprites per row, each with room for a hexagon of the sprite size
+    int cell = 2 * this->sprite_size + 2;
+    return {(sprite % 3) * cell, (sprite / 3) * cell, cell, cell};
+}
+
+void HexagonGrid::load_atlas()
+{
+    SDL_Renderer *renderer = this->renderer->get_renderer();
+    if (this->atlas != nullptr)
+    {
+        SDL_DestroyTexture(this->atlas);
+    }
+    this->atlas_size = this->layout->size;
+    // at high zoom the atlas may exceed the renderer's limit, the sprites are drawn smaller then
+    // and scaled up when copied
+    this->sprite_size = this->atlas_size;
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) == 0)
+    {
+        if (info.max_texture_width > 0)
+            this->sprite_size = (Sint16) std::min<int>(this->sprite_size, info.max_texture_width / 6 - 1);
+        if (info.max_texture_height > 0)
+            this->sprite_size = (Sint16) std::min<int>(this->sprite_size, info.max_texture_height / 4 - 1);
+    }
+    int cell = 2 * this->sprite_size + 2;
+    this->atlas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, 3 * cell, 2 * cell);
+    if (this->atlas == nullptr)
+    {
+        throw SDL_TextureException();
+    }
+    SDL_SetTextureBlendMode(this->atlas, SDL_BLENDMODE_BLEND);
+    this->renderer->set_target(this->atlas);
+    this->renderer->set_draw_color({0x00, 0x00, 0x00, 0x00});
+    this->renderer->clear();
+    // everything is drawn in white, the color is applied when copying
+    std::vector<Point> corners = field_to_polygon_normalized({0, 0, 0}, this->layout);
+    double scale = (double) this->sprite_size / this->atlas_size;
+    for (Point &corner : corners)
+    {
+        corner = corner * scale;
+    }
+    double resource_size = this->sprite_size / 4;
+    static const SDL_Point trigon[] = {{0,  -1},
+                                       {-1, 1},
+                                       {1,  1}};
+    static const SDL_Point square[] = {{-1, -1},
+                                       {-1, 1},
+                                       {1,  1},
+                                       {1,  -1}};
+    Sint16 vx[6];
+    Sint16 vy[6];
+    for (int sprite = SpriteFill; sprite <= SpriteSquare; sprite++)
+    {
+        SDL_Rect box = this->sprite_rect((Sprite) sprite);
+        Sint16 center_x = (Sint16) (box.x + this->sprite_size + 1);
+        Sint16 center_y = (Sint16) (box.y + this->sprite_size + 1);
+        switch (sprite)
+        {
+            case SpriteFill:
+            case SpriteOutline:
+                for (int i = 0; i < 6; i++)
+                {
+                    vx[i] = (Sint16) (center_x + corners[i].x);
+                    vy[i] = (Sint16) (center_y + corners[i].y);
+                }
+                if (sprite == SpriteFill)
+                    filledPolygonRGBA(renderer, vx, vy, 6, 0xff, 0xff, 0xff, 0xff);
+                else
+                    polygonRGBA(renderer, vx, vy, 6, 0xff, 0xff, 0xff, 0xff);
+                break;
+            case SpriteTriangle:
+                for (int i = 0; i < 3; i++)
+                {
+                    vx[i] = (Sint16) (center_x + (trigon[i].x * resource_size));
+                    vy[i] = (Sint16) (center_y + (trigon[i].y * resource_size));
+                }
+                trigonRGBA(renderer, vx[0], vy[0], vx[1], vy[1], vx[2], vy[2], 0xff, 0xff, 0xff, 0xff);
+                break;
+            case SpriteCircle:
+                circleRGBA(renderer, center_x, center_y, (Sint16) resource_size, 0xff, 0xff, 0xff, 0xff);
+                break;
+            case SpriteSquare:
+                for (int i = 0; i < 4; i++)
+                {
+                    vx[i] = (Sint16) (center_x + square[i].x * resource_size);
+                    vy[i] = (Sint16) (center_y + square[i].y * resource_size);
+                }
+                polygonRGBA(renderer, vx, vy, 4, 0xff, 0xff, 0xff, 0xff);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void HexagonGrid::copy_sprite(Sprite sprite, FieldMeta *meta)
+{
+    Point center = this->field_to_point(meta);
+    SDL_Rect source = this->sprite_rect(sprite);
+    // as big as the field, even if the sprite is smaller
+    int cell = 2 * this->atlas_size + 2;
+    SDL_Rect destination = {(int) center.x - this->atlas_size - 1 + this->draw_offset.x,
+                            (int) center.y - this->atlas_size - 1 + this->draw_offset.y, cell, cell};
+    this->renderer->copy(this->atlas, &source, &destination);
+}
+
+SDL_Color HexagonGrid::field_color(FieldMeta *meta)
+{
+    if (this->attack_marker == meta)
+        return {0x0, 0x77, 0x77, 0xff};
+    if (meta->get_owner_id() == 0)
+        return {0x22, 0x22, 0x22, 0xff};
+    return to_sdl_color(meta->get_owner().get_color());
+}
+
+void HexagonGrid::load_resources(FieldMeta *meta)
+{
+    Resource resources_base = meta->get_resources_base();
+    if (resources_base.triangle > 0)
+        this->copy_sprite(SpriteTriangle, meta);
+    if (resources_base.circle > 0)
+        this->copy_sprite(SpriteCircle, meta);
+    if (resources_base.square > 0)
+        this->copy_sprite(SpriteSquare, meta);
+}
+
+void HexagonGrid::load_marker()
+{
+    SDL_SetTextureColorMod(this->atlas, 0x77, 0x77, 0x77);
+    SDL_SetTextureAlphaMod(this->atlas, 0x77);
+    this->copy_sprite(SpriteFill, this->marker);
+    SDL_SetTextureAlphaMod(this->atlas, 0xff);
+}
+
+SDL_Rect HexagonGrid::get_bounds()
+{
+    // the box with a margin, fields partially inside are drawn as well
+    SDL_Rect bounds = this->layout->box;
+    bounds.x -= 4 * this->layout->size;
+    bounds.y -= 4 * this->layout->size;
+    bounds.w += 8 * this->layout->size;
+    bounds.h += 8 * this->layout->size;
+    return bounds;
 }
 
-Resource HexagonGrid::get_resources_of_cluster(Cluster *cluster)
+// range of t with low < base + factor * t < high, widened by a field on both sides against rounding
+static bool solve_range(double base, double factor, double low, double high, double *from, double *to)
 {
-    Resource res = {0, 0, 0};
-    for (FieldMeta *elem : *cluster)
+    if (factor == 0)
     {
-        Resource r_plus = elem->get_resources();
-        res += r_plus;
+        *from = -INFINITY;
+        *to = INFINITY;
+        return base > low - 1 && base < high + 1;
     }
-    return res;
+    double a = (low - base) / factor;
+    double b = (high - base) / factor;
+    *from = std::min(a, b) - 1;
+    *to = std::max(a, b) + 1;
+    return true;
 }
 
-bool FieldMeta::upgrade(Upgrade upgrade)
+bool HexagonGrid::fields_in_rect(const SDL_Rect *rect, std::vector<FieldMeta *> *found)
 {
-    // check available resources for cluster and consume resources
-    if (this->upgrades[upgrade])
-        return this->upgrades[upgrade];
-    Cluster cluster = this->grid->get_cluster(this);
-    Resource cluster_resources = this->grid->get_resources_of_cluster(&cluster);
-    auto pair = UPGRADE_COSTS.find(upgrade);
-    if (pair != UPGRADE_COSTS.end())
+    // the x range follows from the rectangle's corners in field coordinates,
+    // then every row x is cut to the y range whose centers can lie inside
+    const Orientation &m = this->layout->orientation;
+    double size = this->layout->size;
+    double x_min = INFINITY;
+    double x_max = -INFINITY;
+    for (int corner = 0; corner < 4; corner++)
     {
-        Resource costs = pair->second;
-        if (costs > cluster_resources) // too expensive for you
-            return this->upgrades[upgrade];
-        Resource remaining_costs = this->grid->consume_resources_of_cluster(&cluster, costs);
-        static const Resource neutral = {0, 0, 0};
-        if (remaining_costs == neutral)
+        double px = rect->x + ((corner & 1) ? rect->w : 0) - this->layout->origin.x;
+        double py = rect->y + ((corner & 2) ? rect->h : 0) - this->layout->origin.y;
+        double x = (m.b0 * px + m.b1 * py) / size;
+        x_min = std::min(x_min, x);
+        x_max = std::max(x_max, x);
+    }
+    int radius = this->radius;
+    int x_first = std::max(-radius, (int) std::floor(x_min) - 1);
+    int x_last = std::min(radius, (int) std::ceil(x_max) + 1);
+    bool any = false;
+    for (int x = x_first; x <= x_last; x++)
+    {
+        double from_h, to_h, from_v, to_v;
+        if (!solve_range(this->layout->origin.x + size * m.f0 * x, size * m.f1, rect->x, rect->x + rect->w,
+                         &from_h, &to_h)
+            || !solve_range(this->layout->origin.y + size * m.f2 * x, size * m.f3, rect->y, rect->y + rect->h,
+                            &from_v, &to_v))
+            continue;
+        int y_first = std::max(std::max(-radius, -x - radius), (int) std::floor(std::max(from_h, from_v)));
+        int y_last = std::min(std::min(radius, -x + radius), (int) std::ceil(std::min(to_h, to_v)));
+        if (y_first > y_last)
+            continue;
+        // a row is stored contiguously, y ascending
+        FieldMeta *row = this->get_field(Field((int16_t) x, (int16_t) y_first, (int16_t) (-x - y_first)));
+        for (int y = y_first; y <= y_last; y++)
         {
-            this->upgrades[upgrade] = true;
+            FieldMeta *meta = row + (y - y_first);
+            Point center = this->field_to_point(meta);
+            SDL_Point i_c;
+            i_c.x = (int) center.x;
+            i_c.y = (int) center.y;
+            if (!inside_target(rect, &i_c))
+                continue;
+            if (found == nullptr)
+                return true;
+            found->push_back(meta);
+            any = true;
         }
     }
-    trigger_event(BOB_FIELDUPGRADEVENT, 0, (void *) this, nullptr);
-    return this->upgrades[upgrade];
+    return any;
 }
 
-FieldMeta *FieldMeta::get_neighbor(Uint8 direction)
+void HexagonGrid::load()
 {
-    return this->grid->get_neighbor(this, direction);
+    SDL_Point size = {this->layout->box.w, this->layout->box.h};
+    if (this->texture == nullptr || this->texture_size.x != size.x || this->texture_size.y != size.y)
+    {
+        SDL_DestroyTexture(this->texture);
+        this->texture = SDL_CreateTexture(this->renderer->get_renderer(), SDL_PIXELFORMAT_RGBA8888,
+                                          SDL_TEXTUREACCESS_TARGET, size.x, size.y);
+        if (this->texture == nullptr)
+            throw SDL_TextureException();
+        this->texture_size = size;
+    }
+    if (this->atlas == nullptr || this->atlas_size != this->layout->size)
+    {
+        this->load_atlas();
+    }
+    this->scroll = {0, 0};
+    this->scrolled = {0, 0};
+    this->renderer->set_target(this->texture);
+    this->load_region(this->layout->box);
+    this->renderer->set_target(nullptr);
+    // everything is up to date now
+    for (uint32_t index : this->dirty)
+    {
+        this->dirty_marks[index] = false;
+    }
+    this->dirty.clear();
 }
 
-FieldMeta *HexagonGrid::get_neighbor(FieldMeta *meta, Uint8 direction)
+static int wrap(int value, int size)
 {
-    Field neighbor_field = meta->get_field().get_neighbor(direction);
-    FieldMeta *neighbor = nullptr;
-    auto pair = this->fields.find(neighbor_field);
-    if (pair != this->fields.end())
-        neighbor = pair->second;
-    return neighbor;
+    int rest = value % size;
+    return rest < 0 ? rest + size : rest;
 }
 
-Cluster HexagonGrid::get_cluster(FieldMeta *field)
+void HexagonGrid::load_scrolled()
 {
-    Cluster visited = Cluster();
-    FieldMeta *current = nullptr;
-    std::set<FieldMeta *> seen = {field};
-    while (!seen.empty()) // still unvisited fields, that can be reached
+    SDL_Point m = this->scrolled;
+    this->scrolled = {0, 0};
+    SDL_Rect box = this->layout->box;
+    if (std::abs(m.x) >= box.w || std::abs(m.y) >= box.h)
     {
-        current = *(seen.begin());
-        seen.erase(current);
-        for (Uint8 i = 0; i < 6; i++)
+        this->load();
+        return;
+    }
+    // the content of the box moved by m, what is now at p was at p - m before
+    this->scroll.x = wrap(this->scroll.x - m.x, this->texture_size.x);
+    this->scroll.y = wrap(this->scroll.y - m.y, this->texture_size.y);
+    this->renderer->set_target(this->texture);
+    if (m.x > 0)
+        this->load_region({box.x, box.y, m.x, box.h});
+    else if (m.x < 0)
+        this->load_region({box.x + box.w + m.x, box.y, -m.x, box.h});
+    if (m.y > 0)
+        this->load_region({box.x, box.y, box.w, m.y});
+    else if (m.y < 0)
+        this->load_region({box.x, box.y + box.h + m.y, box.w, -m.y});
+    this->renderer->set_target(nullptr);
+}
+
+void HexagonGrid::load_region(SDL_Rect area)
+{
+    // area is in box coordinates, it wraps around the edges of the texture in up to four pieces
+    SDL_Rect box = this->layout->box;
+    Sint16 size = this->layout->size;
+    for (int done_y = 0; done_y < area.h;)
+    {
+        int texture_y = wrap(area.y - box.y + done_y + this->scroll.y, this->texture_size.y);
+        int piece_h = std::min(area.h - done_y, this->texture_size.y - texture_y);
+        for (int done_x = 0; done_x < area.w;)
         {
-            FieldMeta *neighbor = this->get_neighbor(current, i);
-            // neighbor is unvisited, unseen and inside same cluster
-            if (neighbor != nullptr && neighbor->get_owner() == current->get_owner()
-                && visited.find(neighbor) == visited.end() && seen.find(neighbor) == seen.end())
+            int texture_x = wrap(area.x - box.x + done_x + this->scroll.x, this->texture_size.x);
+            int piece_w = std::min(area.w - done_x, this->texture_size.x - texture_x);
+            SDL_Rect piece = {texture_x, texture_y, piece_w, piece_h};
+            this->draw_offset = {texture_x - area.x - done_x, texture_y - area.y - done_y};
+            this->renderer->set_clip_rect(&piece);
+            this->renderer->set_blend_mode(SDL_BLENDMODE_NONE);
+            this->renderer->set_draw_color({0x00, 0x00, 0x00, 0x00});
+            this->renderer->fill_rect(&piece);
+            this->renderer->set_blend_mode(SDL_BLENDMODE_BLEND);
+            // every field reaching into the piece, the clip rect keeps the rest untouched
+            SDL_Rect reach = {area.x + done_x - size - 1, area.y + done_y - size - 1, piece_w + 2 * size + 2,
+                              piece_h + 2 * size + 2};
+            this->visible.clear();
+            this->fields_in_rect(&reach, &(this->visible));
+            // one pass per sprite, the copies in between state changes can be batched by the renderer
+            SDL_Color last = {0x0, 0x0, 0x0, 0x0};
+            for (FieldMeta *meta : this->visible)
+            {
+                SDL_Color color = this->field_color(meta);
+                if (color.r != last.r || color.g != last.g || color.b != last.b || last.a == 0x0)
+                {
+                    SDL_SetTextureColorMod(this->atlas, color.r, color.g, color.b);
+                    last = color;
+                }
+                this->copy_sprite(SpriteFill, meta);
+            }
+            SDL_SetTextureColorMod(this->atlas, 0xff, 0xff, 0xff);
+            for (FieldMeta *meta : this->visible)
             {
-                seen.insert(neighbor); // discovered an unseen neighbor, will visit later
+                if (size >= this->lod_glyphs)
+                    this->load_resources(meta);
             }
+            for (FieldMeta *meta : this->visible)
+            {
+                if (size >= this->lod_outlines)
+                    this->copy_sprite(SpriteOutline, meta);
+            }
+            if (std::find(this->visible.begin(), this->visible.end(), this->marker) != this->visible.end())
+            {
+                this->load_marker();
+            }
+            done_x += piece_w;
         }
-        visited.insert(current); // have seen all of the neighbors for this field
+        done_y += piece_h;
+    }
+    this->renderer->set_clip_rect(nullptr);
+    this->draw_offset = {0, 0};
+}
+
+void HexagonGrid::mark_dirty(FieldMeta *meta)
+{
+    if (meta == nullptr)
+        return;
+    uint32_t index = this->get_index(meta);
+    if (!this->dirty_marks[index])
+    {
+        this->dirty_marks[index] = true;
+        this->dirty.push_back(index);
+    }
+}
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+// vertices per slot: a fan for the fill, a quad per edge of the outline and per resource glyph
+static const int FILL_VERTICES = 7;
+static const int OUTLINE_VERTICES = 6 * 4;
+static const int GLYPH_VERTICES = 3 * 4;
+static const int SLOT_VERTICES = FILL_VERTICES + OUTLINE_VERTICES + GLYPH_VERTICES;
+
+static void push_quad(std::vector<int> &indices, int first)
+{
+    indices.push_back(first);
+    indices.push_back(first + 1);
+    indices.push_back(first + 2);
+    indices.push_back(first);
+    indices.push_back(first + 2);
+    indices.push_back(first + 3);
+}
+
+static void push_fan(std::vector<int> &indices, int center)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        indices.push_back(center);
+        indices.push_back(center + 1 + i);
+        indices.push_back(center + 1 + (i + 1) % 6);
     }
-    return visited;
 }
 
-void FieldMeta::consume_resources(Resource costs)
+SDL_FPoint HexagonGrid::sprite_coordinate(Sprite sprite, double x, double y)
 {
-    this->resources -= costs;
+    // x and y are relative to the sprite, 0 to 1
+    SDL_Rect box = this->sprite_rect(sprite);
+    int cell = 2 * this->sprite_size + 2;
+    return {(float) ((box.x + x * box.w) / (3 * cell)), (float) ((box.y + y * box.h) / (2 * cell))};
 }
 
-Resource HexagonGrid::consume_resources_of_cluster(Cluster *cluster, Resource costs)
+void HexagonGrid::load_geometry()
 {
-    for (FieldMeta *meta : *cluster)
+    if (this->atlas == nullptr || this->atlas_size != this->layout->size)
     {
-        // mind the "special" definition of -=, only byte of what you can chew or leave nothing behind
-        Resource tmp = costs;
-        costs -= meta->get_resources();
-        meta->consume_resources(tmp);
+        this->load_atlas();
+        this->renderer->set_target(nullptr);
     }
-    trigger_event(BOB_FIELDUPDATEEVENT, 0, (void *) this, nullptr);
-    return costs; // > {0, 0, 0} means there were not enough resources
+    this->corners = field_to_polygon_normalized({0, 0, 0}, this->layout);
+    this->visible.clear();
+    this->slots.assign(this->fields.size(), -1);
+    this->slot_fields.clear();
+    this->free_slots.clear();
+    SDL_Rect bounds = this->get_bounds();
+    this->fields_in_rect(&bounds, &(this->visible));
+    for (FieldMeta *meta : this->visible)
+    {
+        uint32_t index = this->get_index(meta);
+        this->slots[index] = (int32_t) this->slot_fields.size();
+        this->slot_fields.push_back((int32_t) index);
+    }
+    this->load_geometry_indices();
+    for (FieldMeta *meta : this->visible)
+    {
+        this->load_geometry_field(meta);
+    }
+    this->load_geometry_marker();
+    for (uint32_t index : this->dirty)
+    {
+        this->dirty_marks[index] = false;
+    }
+    this->dirty.clear();
 }
 
-bool Player::fight(FieldMeta *field)
+void HexagonGrid::load_geometry_scrolled()
 {
-    bool is_neighbor = false; // player has a field around here
-    // friendly fire or owned by default player
-    if (*this == field->get_owner() || field->get_owner().get_id() == boost::uuids::nil_uuid())
+    SDL_Point m = this->scrolled;
+    this->scrolled = {0, 0};
+    SDL_Rect bounds = this->get_bounds();
+    if (std::abs(m.x) >= this->layout->box.w || std::abs(m.y) >= this->layout->box.h)
     {
-        return false;
+        this->load_geometry();
+        return;
     }
-    Cluster defenders_cluster = field->get_grid()->get_cluster(field);
-    Resource defenders_cluster_res = field->get_grid()->get_resources_of_cluster(&defenders_cluster);
-    Cluster attackers_cluster;
-    // defending player's Defense against attacking player's offense
-    int power_level = field->get_defense(); // it's over 9000
-    for (Uint8 i = 0; i < 6; i++)
+    // the vertices move along with the fields, the marker's too
+    for (SDL_Vertex &vertex : this->vertices)
     {
-        FieldMeta *neighbor = field->get_neighbor(i);
-        if (neighbor == nullptr) // there is no neighbor in this direction
-        {
+        vertex.position.x += m.x;
+        vertex.position.y += m.y;
+    }
+    // the fields that left the bounds give up their slots
+    for (uint32_t slot = 0; slot < this->slot_fields.size(); slot++)
+    {
+        int32_t index = this->slot_fields[slot];
+        if (index < 0)
             continue;
-        }
-        if (neighbor->get_owner() == *this) // comparison by UUID, attacking player
+        Point center = this->field_to_point(&(this->fields[index]));
+        SDL_Point i_c = {(int) center.x, (int) center.y};
+        if (inside_target(&bounds, &i_c))
+            continue;
+        this->slots[index] = -1;
+        this->slot_fields[slot] = -1;
+        this->free_slots.push_back((int32_t) slot);
+        this->clear_geometry_slot((int32_t) slot);
+    }
+    // the fields coming into view are in the strips the bounds moved over, widened against rounding
+    SDL_Rect strips[2] = {{0, 0, 0, 0}, {0, 0, 0, 0}};
+    if (m.x > 0)
+        strips[0] = {bounds.x - 2, bounds.y, m.x + 4, bounds.h};
+    else if (m.x < 0)
+        strips[0] = {bounds.x + bounds.w + m.x - 2, bounds.y, -m.x + 4, bounds.h};
+    if (m.y > 0)
+        strips[1] = {bounds.x, bounds.y - 2, bounds.w, m.y + 4};
+    else if (m.y < 0)
+        strips[1] = {bounds.x, bounds.y + bounds.h + m.y - 2, bounds.w, -m.y + 4};
+    this->visible.clear();
+    for (SDL_Rect &strip : strips)
+    {
+        if (strip.w > 0 && strip.h > 0)
+            this->fields_in_rect(&strip, &(this->visible));
+    }
+    size_t entered = 0;
+    size_t num_slots = this->slot_fields.size();
+    for (FieldMeta *meta : this->visible)
+    {
+        uint32_t index = this->get_index(meta);
+        Point center = this->field_to_point(meta);
+        SDL_Point i_c = {(int) center.x, (int) center.y};
+        if (this->slots[index] >= 0 || !inside_target(&bounds, &i_c))
+            continue;
+        int32_t slot;
+        if (this->free_slots.empty())
         {
-            Cluster temp_attackers_cluster = neighbor->get_grid()->get_cluster(neighbor);
-            attackers_cluster.insert(temp_attackers_cluster.begin(), temp_attackers_cluster.end());
-            power_level -= neighbor->get_offense();
-            is_neighbor = true;
+            slot = (int32_t) this->slot_fields.size();
+            this->slot_fields.push_back(-1);
         }
-        else if (neighbor->get_owner() == field->get_owner()) // attacked player
+        else
         {
-            power_level += neighbor->get_defense();
+            slot = this->free_slots.back();
+            this->free_slots.pop_back();
         }
-        // else: ignore, field / player not part of the fight (e.g. default player)
+        this->slots[index] = slot;
+        this->slot_fields[slot] = (int32_t) index;
+        this->visible[entered++] = meta;
     }
-    Resource costs = {(Uint32) std::abs(power_level), (Uint32) std::abs(power_level), (Uint32) std::abs(power_level)};
-    if (power_level < 2 && is_neighbor &&
-        costs <= field->get_grid()->get_resources_of_cluster(&attackers_cluster)) // attacking player has won
+    this->visible.resize(entered);
+    // more fields in view than ever before, the marker moves behind the new slots
+    if (this->slot_fields.size() != num_slots)
+        this->load_geometry_indices();
+    for (FieldMeta *meta : this->visible)
     {
-        field->get_grid()->consume_resources_of_cluster(&attackers_cluster, costs);
-        field->get_grid()->consume_resources_of_cluster(&defenders_cluster, costs);
-        field->set_owner(*this);
-        return true;
+        this->load_geometry_field(meta);
     }
-    else // lost
+}
+
+void HexagonGrid::load_geometry_indices()
+{
+    // the marker overlay comes last, after all slots
+    int num_slots = (int) this->slot_fields.size();
+    this->vertices.resize(num_slots * SLOT_VERTICES + FILL_VERTICES);
+    // drawn in passes, fills first so outlines and glyphs are never covered by a neighbor
+    this->indices.clear();
+    for (int slot = 0; slot < num_slots; slot++)
     {
-        field->get_grid()->consume_resources_of_cluster(&attackers_cluster, costs);
-        return false;
+        push_fan(this->indices, slot * SLOT_VERTICES);
     }
+    for (int slot = 0; slot < num_slots && this->layout->size >= this->lod_glyphs; slot++)
+    {
+        for (int glyph = 0; glyph < 3; glyph++)
+        {
+            push_quad(this->indices, slot * SLOT_VERTICES + FILL_VERTICES + OUTLINE_VERTICES + 4 * glyph);
+        }
+    }
+    for (int slot = 0; slot < num_slots && this->layout->size >= this->lod_outlines; slot++)
+    {
+        for (int edge = 0; edge < 6; edge++)
+        {
+            push_quad(this->indices, slot * SLOT_VERTICES + FILL_VERTICES + 4 * edge);
+        }
+    }
+    push_fan(this->indices, num_slots * SLOT_VERTICES);
 }
 
-void FieldMeta::handle_event(const SDL_Event *event)
+void HexagonGrid::clear_geometry_slot(int32_t slot)
 {
-    if (event->type == BOB_NEXTROUNDEVENT)
+    // degenerate and transparent, covers nothing until a field takes the slot
+    SDL_Vertex *vertex = &(this->vertices[slot * SLOT_VERTICES]);
+    for (int i = 0; i < SLOT_VERTICES; i++)
     {
-        this->regenerate_resources();
-        this->changed = true;
+        vertex[i] = {{0.0f, 0.0f}, {0x0, 0x0, 0x0, 0x0}, {0.0f, 0.0f}};
     }
 }
 
-void FieldMeta::load(SDL_Renderer *renderer, Layout *layout)
+void HexagonGrid::load_geometry_field(FieldMeta *meta)
 {
-    Point precise_location = this->field.field_to_point(layout);
-    SDL_Point location;
-    location.x = (int) precise_location.x;
-    location.y = (int) precise_location.y;
-    std::vector<Point> polygon = this->field.field_to_polygon(layout);
-    SDL_Color color = this->owner.get_color();
-    Sint16 vx[6];
-    Sint16 vy[6];
+    int32_t slot = this->slots[this->get_index(meta)];
+    if (slot < 0)
+        return;
+    SDL_Vertex *vertex = &(this->vertices[slot * SLOT_VERTICES]);
+    Point center = this->field_to_point(meta);
+    SDL_FPoint solid = this->sprite_coordinate(SpriteFill, 0.5, 0.5);
+    SDL_Color color = this->field_color(meta);
+    static const SDL_Color white = {0xff, 0xff, 0xff, 0xff};
+    vertex[0] = {{(float) center.x, (float) center.y}, color, solid};
     for (int i = 0; i < 6; i++)
     {
-        vx[i] = (Sint16) polygon[i].x;
-        vy[i] = (Sint16) polygon[i].y;
-    }
-    if (this->owner.get_id().is_nil())
-        color = {0x22, 0x22, 0x22, 0xff};
-    if (this->get_grid()->get_attack_marker() == this)
-        color = {0x0, 0x77, 0x77, 0xff};
-    filledPolygonRGBA(renderer, vx, vy, 6, color.r, color.g, color.b, 0xff);
-    SDL_Color fg = {0xff, 0xff, 0xff, 0xff};
-    double resource_size = layout->size / 4;
-    if (this->resources_base.triangle > 0)
-    {
-        static const SDL_Point trigon[] = {{0,  -1},
-                                           {-1, 1},
-                                           {1,  1}};
-        for (int i = 0; i < 3; i++)
+        Point corner = center + this->corners[i];
+        vertex[1 + i] = {{(float) corner.x, (float) corner.y}, color, solid};
+    }
+    // left out details aren't indexed, no need to fill their vertices
+    if (this->layout->size < this->lod_outlines)
+        return;
+    vertex += FILL_VERTICES;
+    for (int edge = 0; edge < 6; edge++)
+    {
+        // one pixel wide, half of it on each side of the edge
+        Point from = center + this->corners[edge];
+        Point to = center + this->corners[(edge + 1) % 6];
+        Point direction = {to.x - from.x, to.y - from.y};
+        double length = !direction;
+        Point normal = {-direction.y / length * 0.5, direction.x / length * 0.5};
+        Point quad[] = {from + normal, to + normal, to + normal * -1.0, from + normal * -1.0};
+        for (int i = 0; i < 4; i++)
         {
-            vx[i] = (Sint16) (location.x + (trigon[i].x * resource_size));
-            vy[i] = (Sint16) (location.y + (trigon[i].y * resource_size));
+            vertex[4 * edge + i] = {{(float) quad[i].x, (float) quad[i].y}, white, solid};
         }
-        trigonRGBA(renderer, vx[0], vy[0], vx[1], vy[1], vx[2], vy[2], fg.r, fg.g, fg.b, fg.a);
     }
-    if (this->resources_base.circle > 0)
+    if (this->layout->size < this->lod_glyphs)
+        return;
+    vertex += OUTLINE_VERTICES;
+    Resource resources_base = meta->get_resources_base();
+    static const Sprite glyphs[] = {SpriteTriangle, SpriteCircle, SpriteSquare};
+    bool present[] = {resources_base.triangle > 0, resources_base.circle > 0, resources_base.square > 0};
+    static const double corner_x[] = {0.0, 1.0, 1.0, 0.0};
+    static const double corner_y[] = {0.0, 0.0, 1.0, 1.0};
+    double half = this->atlas_size + 1;
+    for (int glyph = 0; glyph < 3; glyph++)
     {
-        circleRGBA(renderer, (Sint16) (location.x), Sint16(location.y), (Sint16) resource_size, fg.r, fg.g,
-                   fg.b, fg.a);
+        for (int i = 0; i < 4; i++)
+        {
+            SDL_Vertex &v = vertex[4 * glyph + i];
+            if (present[glyph])
+            {
+                v.position = {(float) (center.x - half + 2 * half * corner_x[i]),
+                              (float) (center.y - half + 2 * half * corner_y[i])};
+                v.color = white;
+            }
+            else
+            {
+                // degenerate, covers nothing
+                v.position = {(float) center.x, (float) center.y};
+                v.color = {0x0, 0x0, 0x0, 0x0};
+            }
+            v.tex_coord = this->sprite_coordinate(glyphs[glyph], corner_x[i], corner_y[i]);
+        }
     }
-    if (this->resources_base.square > 0)
+}
+
+void HexagonGrid::load_geometry_marker()
+{
+    SDL_Vertex *vertex = &(this->vertices[this->slot_fields.size() * SLOT_VERTICES]);
+    SDL_FPoint solid = this->sprite_coordinate(SpriteFill, 0.5, 0.5);
+    SDL_Color color = {0x77, 0x77, 0x77, 0x77};
+    if (this->slots[this->get_index(this->marker)] < 0)
+        color.a = 0x0;
+    Point center = this->field_to_point(this->marker);
+    vertex[0] = {{(float) center.x, (float) center.y}, color, solid};
+    for (int i = 0; i < 6; i++)
     {
-        static const SDL_Point square[] = {{-1, -1},
-                                           {-1, 1},
-                                           {1,  1},
-                                           {1,  -1}};
-        for (int i = 0; i < 4; i++)
+        Point corner = center + this->corners[i];
+        vertex[1 + i] = {{(float) corner.x, (float) corner.y}, color, solid};
+    }
+}
+
+static Uint32 texel(SDL_Color color)
+{
+    return ((Uint32) color.r << 24) | ((Uint32) color.g << 16) | ((Uint32) color.b << 8) | 0xff;
+}
+
+void HexagonGrid::load_image_field(FieldMeta *meta)
+{
+    // texel column x, row y, the hexagon's corners stay transparent
+    Field field = meta->get_field();
+    int side = 2 * this->radius + 1;
+    this->image_pixels[(field.y + this->radius) * side + field.x + this->radius] = texel(this->field_color(meta));
+}
+
+void HexagonGrid::load_image()
+{
+    int side = 2 * this->radius + 1;
+    if (this->image == nullptr)
+    {
+        this->image = SDL_CreateTexture(this->renderer->get_renderer(), SDL_PIXELFORMAT_RGBA8888,
+                                        SDL_TEXTUREACCESS_STREAMING, side, side);
+        if (this->image == nullptr)
         {
-            vx[i] = (Sint16) (location.x + square[i].x * resource_size);
-            vy[i] = (Sint16) (location.y + square[i].y * resource_size);
+            throw SDL_TextureException();
         }
-        polygonRGBA(renderer, vx, vy, 4, fg.r, fg.g, fg.b, fg.a);
+        SDL_SetTextureBlendMode(this->image, SDL_BLENDMODE_BLEND);
+        this->changed = true;
+    }
+    bool update = this->changed || !this->dirty.empty();
+    if (this->changed)
+    {
+        this->image_pixels.assign(side * side, 0);
+        // a color per owner, then only the positions and owners of the fields are streamed
+        std::vector<Uint32> colors;
+        colors.push_back(texel({0x22, 0x22, 0x22, 0xff}));
+        for (PlayerId id = 1; id < this->players->size(); id++)
+        {
+            colors.push_back(texel(to_sdl_color(this->players->get(id).get_color())));
+        }
+        for (uint32_t index = 0; index < this->fields.size(); index++)
+        {
+            Field field = this->cells.positions[index];
+            this->image_pixels[(field.y + this->radius) * side + field.x + this->radius] =
+                    colors[this->cells.owners[index]];
+        }
+        if (this->attack_marker != nullptr)
+            this->load_image_field(this->attack_marker);
+        this->changed = false;
+    }
+    for (uint32_t index : this->dirty)
+    {
+        this->dirty_marks[index] = false;
+        this->load_image_field(&(this->fields[index]));
+    }
+    this->dirty.clear();
+    if (update && SDL_UpdateTexture(this->image, nullptr, this->image_pixels.data(), side * sizeof(Uint32)) < 0)
+    {
+        throw SDL_TextureException();
     }
 }
 
-void HexagonGrid::load()
+void HexagonGrid::render_image(Renderer *renderer)
 {
-    if (this->texture == nullptr)
+    int side = 2 * this->radius + 1;
+    // the texel grid is mapped onto the lattice of field centers, so every texel lands on its field
+    const Orientation &m = this->layout->orientation;
+    static const float corner_u[] = {0, 1, 1, 0};
+    static const float corner_v[] = {0, 0, 1, 1};
+    std::vector<SDL_Vertex> quad(4);
+    for (int i = 0; i < 4; i++)
     {
-        SDL_Rect db;
-        SDL_GetDisplayBounds(0, &db);
-        this->texture = SDL_CreateTexture(this->renderer->get_renderer(), SDL_PIXELFORMAT_RGBA8888,
-                                          SDL_TEXTUREACCESS_TARGET, db.w, db.h);
+        double x = corner_u[i] * side - 0.5 - this->radius;
+        double y = corner_v[i] * side - 0.5 - this->radius;
+        quad[i].position = {(float) (this->layout->origin.x + (m.f0 * x + m.f1 * y) * this->layout->size),
+                            (float) (this->layout->origin.y + (m.f2 * x + m.f3 * y) * this->layout->size)};
+        quad[i].color = {0xff, 0xff, 0xff, 0xff};
+        quad[i].tex_coord = {corner_u[i], corner_v[i]};
     }
-    this->renderer->set_target(this->texture);
-    renderer->set_draw_color({0x00, 0x00, 0x00, 0x00});
-    this->renderer->clear();
-    SDL_Rect bounds = this->layout->box;
-    bounds.x -= 4 * this->layout->size;
-    bounds.y -= 4 * this->layout->size;
-    bounds.w += 8 * this->layout->size;
-    bounds.h += 8 * this->layout->size;
-    renderer->set_draw_color({0xff, 0xff, 0xff, 0xff});
-    renderer->set_blend_mode(SDL_BLENDMODE_BLEND);
-    Field some_field = {0, 0, 0};
-    std::vector<Point> norm_polygon = some_field.field_to_polygon_normalized(this->layout);
-    for (std::pair<Field, FieldMeta *> const &elem : this->fields)
-    {
-        Field field = elem.first;
-        Point center = field.field_to_point(this->layout);
-        SDL_Point i_c;
-        i_c.x = (int) center.x;
-        i_c.y = (int) center.y;
-        if (inside_target(&bounds, &i_c))
+    static const std::vector<int> quad_indices = {0, 1, 2, 0, 2, 3};
+    renderer->render_geometry(this->image, quad, quad_indices);
+}
+#endif
+
+SDL_Rect HexagonGrid::field_rect(FieldMeta *meta)
+{
+    Point center = this->field_to_point(meta);
+    Sint16 size = this->layout->size;
+    return {(int) center.x - size - 1, (int) center.y - size - 1, 2 * size + 2, 2 * size + 2};
+}
+
+void HexagonGrid::prepare(Damage *damage)
+{
+    ScopedTimer timer("grid prepare");
+    bool scrolled = this->scrolled.x != 0 || this->scrolled.y != 0;
+    if (this->changed)
+    {
+        damage->add(this->layout->box);
+    }
+    else
+    {
+        // the frame is scrolled along, only the strips coming into view are drawn again
+        if (scrolled)
+            damage->scroll(this->layout->box, this->scrolled);
+        for (uint32_t index : this->dirty)
         {
-            elem.second->load(this->renderer->get_renderer(), this->layout);
-            //std::vector<SDL_Point> polygon = field.field_to_polygon_sdl(this->layout);
-            Sint16 vx[6];
-            Sint16 vy[6];
-            for (int i = 0; i < 6; i++)
-            {
-                vx[i] = (Sint16) (center.x + norm_polygon[i].x);
-                vy[i] = (Sint16) (center.y + norm_polygon[i].y);
-            }
-            /*if (SDL_RenderDrawLines(renderer->get_renderer(), polygon.data(), 7) < 0)
-            {
-                throw SDL_RendererException();
-            }*/
-            polygonRGBA(renderer->get_renderer(), vx, vy, 6, 0xff, 0xff, 0xff, 0xff);
-            if (elem.first == this->marker->get_field())
+            damage->add(this->field_rect(&(this->fields[index])));
+        }
+    }
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    if (this->layout->size < this->lod_image)
+    {
+        this->scrolled = {0, 0};
+        this->load_image();
+        return;
+    }
+    if (this->changed)
+    {
+        this->load_geometry();
+        this->changed = false;
+        this->scrolled = {0, 0};
+    }
+    else if (scrolled || !this->dirty.empty())
+    {
+        if (scrolled)
+            this->load_geometry_scrolled();
+        for (uint32_t index : this->dirty)
+        {
+            this->dirty_marks[index] = false;
+            this->load_geometry_field(&(this->fields[index]));
+        }
+        this->dirty.clear();
+        this->load_geometry_marker();
+    }
+#else
+    if (this->changed)
+    {
+        this->load();
+        this->changed = false;
+    }
+    else
+    {
+        if (this->scrolled.x != 0 || this->scrolled.y != 0)
+            this->load_scrolled();
+        if (!this->dirty.empty())
+        {
+            this->renderer->set_target(this->texture);
+            for (uint32_t index : this->dirty)
             {
-                filledPolygonRGBA(this->renderer->get_renderer(), vx, vy, 6, 0x77, 0x77, 0x77, 0x77);
+                this->dirty_marks[index] = false;
+                // the neighbors share the edges, the whole hexagon around the field is redrawn
+                SDL_Rect hexagon = this->field_rect(&(this->fields[index]));
+                SDL_Rect area;
+                if (SDL_IntersectRect(&hexagon, &(this->layout->box), &area))
+                    this->load_region(area);
             }
+            this->dirty.clear();
+            this->renderer->set_target(nullptr);
         }
     }
-    this->renderer->set_target(nullptr);
+#endif
 }
 
 void HexagonGrid::render(Renderer *renderer)
 {
-    if (this->changed)
+    ScopedTimer timer("grid render");
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    if (this->layout->size < this->lod_image)
     {
-        this->load();
-        this->changed = false;
+        this->render_image(renderer);
+        return;
     }
-    renderer->copy(this->texture, &(this->layout->box), &(this->layout->box));
+    SDL_SetTextureColorMod(this->atlas, 0xff, 0xff, 0xff);
+    SDL_SetTextureAlphaMod(this->atlas, 0xff);
+    renderer->render_geometry(this->atlas, this->vertices, this->indices);
+#else
+    // the ring buffer is copied in up to four pieces, split where it wraps around
+    SDL_Rect box = this->layout->box;
+    int split_x = box.w - this->scroll.x;
+    int split_y = box.h - this->scroll.y;
+    SDL_Rect sources[4] = {{this->scroll.x, this->scroll.y, split_x, split_y},
+                           {0, this->scroll.y, this->scroll.x, split_y},
+                           {this->scroll.x, 0, split_x, this->scroll.y},
+                           {0, 0, this->scroll.x, this->scroll.y}};
+    SDL_Point targets[4] = {{0, 0}, {split_x, 0}, {0, split_y}, {split_x, split_y}};
+    for (int i = 0; i < 4; i++)
+    {
+        if (sources[i].w == 0 || sources[i].h == 0)
+            continue;
+        SDL_Rect target = {box.x + targets[i].x, box.y + targets[i].y, sources[i].w, sources[i].h};
+        renderer->copy(this->texture, &(sources[i]), &target);
+    }
+#endif
 }
 
 void HexagonGrid::handle_event(SDL_Event *event)
 {
     SDL_Point mouse = {0, 0};
     SDL_GetMouseState(&mouse.x, &mouse.y);
-    int scroll = this->layout->size / 10 * event->wheel.y;
+    int scroll = std::max(1, this->layout->size / 10) * event->wheel.y;
     double old_size = this->layout->size;
     SDL_Point old_origin = this->layout->origin;
     switch (event->type)
     {
         case SDL_MOUSEWHEEL:
-            if (old_size + scroll < 10)
+            if (old_size + scroll < 1)
             {
-                this->layout->size = 10;
+                this->layout->size = 1;
             }
             else if (old_size + scroll > 1000)
             {
@@ -466,7 +961,7 @@ void HexagonGrid::handle_event(SDL_Event *event)
         case SDL_MOUSEMOTION:
             if (this->panning)
             {
-                Point marker_pos = this->marker->get_field().field_to_point(this->layout);
+                Point marker_pos = this->field_to_point(this->marker);
                 SDL_Point p;
                 p.x = (int) marker_pos.x;
                 p.y = (int) marker_pos.y;
@@ -481,14 +976,13 @@ void HexagonGrid::handle_event(SDL_Event *event)
                     this->panning = !(this->panning);
                     break;
                 case SDL_BUTTON_RIGHT:
-                    trigger_event(BOB_FIELDSELECTEDEVENT, 0, (void *) this->marker, nullptr);
-                    this->changed = true;
+                    this->bus->publish(FieldSelected{this->marker});
                     break;
                 case SDL_BUTTON_LEFT:
                     if (this->placing)
                     {
-                        trigger_event(BOB_FIELDSELECTEDEVENT, 0, (void *) this->marker, nullptr);
                         this->placing = false;
+                        this->bus->publish(FieldSelected{this->marker});
                     }
                     else if (this->attack_marker != nullptr)
                     {
@@ -496,13 +990,14 @@ void HexagonGrid::handle_event(SDL_Event *event)
                         {
                             PlayerManager::pm->get_current().fight(this->attack_marker);
                         }
+                        this->mark_dirty(this->attack_marker);
                         this->attack_marker = nullptr;
                     }
                     else if (this->attack_marker == nullptr)
                     {
                         this->attack_marker = this->marker;
+                        this->mark_dirty(this->attack_marker);
                     }
-                    changed = true;
                     break;
                 default:
                     break;
@@ -511,49 +1006,15 @@ void HexagonGrid::handle_event(SDL_Event *event)
         default:
             if (event->type == BOB_NEXTROUNDEVENT)
             {
-                for (std::pair<Field, FieldMeta *> field : this->fields)
-                {
-                    field.second->regenerate_resources();
-                }
+                this->regenerate();
             }
             if (event->type == BOB_NEXTTURNEVENT || event->type == BOB_NEXTROUNDEVENT)
             {
-                std::default_random_engine generator;
-                std::uniform_real_distribution<double> distribution(0.0, 1.0);
-                std::unordered_set<FieldMeta *> aquired;
-                for (auto pair : this->fields)
-                {
-                    FieldMeta *field = pair.second;
-                    if (field->get_owner() == PlayerManager::pm->get_current())
-                    {
-                        for (Uint8 i = 0; i < 6; i++)
-                        {
-                            FieldMeta *neighbor = field->get_neighbor(i);
-                            if (neighbor != nullptr && neighbor->get_owner() == PlayerManager::pm->default_player)
-                            {
-                                double reproduction = neighbor->get_reproduction();
-                                if(reproduction > distribution(generator))
-                                {
-                                    aquired.insert(neighbor);
-                                }
-                            }
-                        }
-                    }
-                }
-                for (auto foo : aquired)
-                {
-                    foo->set_owner(PlayerManager::pm->get_current());
-                    foo->set_defense(1);
-                    foo->set_offense(1);
-                }
-                this->changed = true;
+                // the fields taken over are marked dirty by owner_changed
+                this->reproduce(PlayerManager::pm->get_current());
             }
             break;
     }
-    for (auto elem : this->fields)
-    {
-        elem.second->handle_event(event);
-    }
 }
 
 void HexagonGrid::move(SDL_Point m)
@@ -562,8 +1023,9 @@ void HexagonGrid::move(SDL_Point m)
     // check if some part is inside layout->box
     if (!on_rectangle(&layout->box))
         this->layout->origin = this->layout->origin - m;
+    else
+        this->scrolled = this->scrolled + m;
     this->update_marker();
-    this->changed = true;
 }
 
 void HexagonGrid::update_marker()
@@ -576,51 +1038,31 @@ void HexagonGrid::update_marker()
     FieldMeta *n_marker = this->point_to_field(p);
     if (n_marker != nullptr)
     {
+        if (n_marker != this->marker)
+        {
+            this->mark_dirty(this->marker);
+            this->mark_dirty(n_marker);
+        }
         this->marker = n_marker;
-        trigger_event(BOB_MARKERUPDATE, 0, (void *) n_marker, nullptr);
+        this->pending_marker = {n_marker, true};
     }
     else
     {
-        trigger_event(BOB_MARKERUPDATE, 1, (void *) marker, nullptr);
+        this->pending_marker = {this->marker, false};
     }
-    this->changed = true;
+    this->marker_pending = true;
 }
 
 FieldMeta *HexagonGrid::point_to_field(const Point p)
 {
     Field field = p.point_to_field(this->layout);
-    FieldMeta *meta = nullptr;
-    auto pair = this->fields.find(field);
-    if (pair != this->fields.end())
-        meta = pair->second;
-    return meta;
-
-}
-
-FieldMeta *HexagonGrid::get_field(Field field)
-{
-    FieldMeta *meta = nullptr;
-    auto pair = this->fields.find(field);
-    if (pair != this->fields.end())
-        meta = pair->second;
-    return meta;
+    return this->get_field(field);
 }
 
 bool HexagonGrid::on_rectangle(SDL_Rect *rect)
 {
     // check if center inside rect for ANY field
-    for (const auto &pair : this->fields)
-    {
-        Point precise_p = pair.first.field_to_point(layout);
-        SDL_Point p;
-        p.x = (int) precise_p.x;
-        p.y = (int) precise_p.y;
-        if (p.x > rect->x && p.y > rect->y && p.x < (rect->x + rect->w) && p.y < (rect->y + rect->h))
-        {
-            return true;
-        }
-    }
-    return false;
+    return this->fields_in_rect(rect, nullptr);
 }
 
 void HexagonGrid::update_dimensions(SDL_Point dimensions)
@@ -633,140 +1075,67 @@ void HexagonGrid::update_dimensions(SDL_Point dimensions)
 
 Point HexagonGrid::field_to_point(FieldMeta *field)
 {
-    return field->get_field().field_to_point(this->layout);
+    return ::field_to_point(field->get_field(), this->layout);
 }
 
-bool inside_target(const SDL_Rect *box, const SDL_Point *position)
+void HexagonGrid::field_changed(FieldMeta *field)
 {
-    return box->x < position->x && box->x + box->w > position->x && box->y < position->y &&
-           box->y + box->h > position->y;
-}
-
-bool HexagonGrid::place(Player &player, FieldMeta *center)
-{
-    std::vector<FieldMeta *> selected;
-    selected.push_back(center);
-    for (Uint8 i = 0; i < 6; i++)
+    uint32_t index = this->get_index(field);
+    if (!this->changed_marks[index])
     {
-        FieldMeta *neighbor = center->get_neighbor(i);
-        if (neighbor != nullptr && neighbor->get_owner().get_id() == boost::uuids::nil_uuid())
-        {
-            selected.push_back(neighbor);
-        }
-        else
-        {
-            return false;
-        }
+        this->changed_marks[index] = true;
+        this->changed_cells.push_back(index);
     }
-    static const Resource lower = {0, 0, 0};
-    Resource resources = {0, 0, 0};
-    for (auto r : selected)
-    {
-        resources += r->get_resources();
-    }
-    if (resources > lower)
-    {
-        for (auto i : selected)
-        {
-            i->set_owner(player);
-            i->set_offense(1);
-            i->set_defense(1);
-        }
-        return true;
-    }
-    return false;
 }
 
-void Player::handle_event(SDL_Event *event)
+void HexagonGrid::all_fields_changed()
 {
-    if (event->type == BOB_NEXTROUNDEVENT)
-    {
-        // nothing atm
-    }
+    // a round, listing every field wouldn't tell anyone more
+    this->all_changed = true;
 }
 
-void HexagonGrid::free(Player &player)
+void HexagonGrid::flush_events()
 {
-    for (std::pair<Field, FieldMeta *> pair : this->fields)
+    if (this->marker_pending)
     {
-        if (pair.second != nullptr && pair.second->get_owner() == player)
-        {
-            Field old_field = pair.second->get_field();
-            delete pair.second;
-            fields.erase(old_field);
-            FieldMeta *new_field = new FieldMeta(this, old_field, PlayerManager::pm->default_player);
-            this->fields.insert({old_field, new_field});
-        }
+        this->marker_pending = false;
+        this->bus->publish(this->pending_marker);
     }
-}
-
-Player &PlayerManager::get_current()
-{
-    if (players.empty())
+    if (this->changed_cells.empty() && !this->all_changed)
+        return;
+    // changes made by the handlers go into the next batch
+    bool all = this->all_changed;
+    this->all_changed = false;
+    std::vector<uint32_t> batch;
+    batch.swap(this->changed_cells);
+    std::vector<uint32_t> watched;
+    for (uint32_t cell : this->bus->watched_cells<FieldChanged>())
     {
-        return default_player;
+        if (all || this->changed_marks[cell])
+            watched.push_back(cell);
     }
-    else
+    for (uint32_t cell : batch)
     {
-        return *current_player;
+        this->changed_marks[cell] = false;
     }
-}
-
-void PlayerManager::next_turn()
-{
-    current_player += 1;
-    if (current_player == players.end())
-    {
-        current_player = players.begin();
-        trigger_event(BOB_NEXTROUNDEVENT, 0, nullptr, nullptr);
-    }
-    else
+    for (uint32_t cell : watched)
     {
-        trigger_event(BOB_NEXTTURNEVENT, 0, nullptr, nullptr);
+        this->bus->publish(cell, FieldChanged{&(this->fields[cell])});
     }
 }
 
-void PlayerManager::shuffle()
+void HexagonGrid::field_upgraded(FieldMeta *field)
 {
-    std::random_shuffle(players.begin(), players.end());
-    current_player = players.begin();
-    trigger_event(BOB_NEXTROUNDEVENT, 0, nullptr, nullptr);
+    this->bus->publish(this->get_index(field), FieldUpgraded{field});
 }
 
-void PlayerManager::add_player(Player &player)
+void HexagonGrid::owner_changed(FieldMeta *field)
 {
-    players.push_back(player);
-    current_player = players.begin();
+    this->mark_dirty(field);
 }
 
-void PlayerManager::surrender(Player &player, HexagonGrid *grid)
-{
-    grid->free(player);
-    //players.erase(std::remove(players.begin(), players.end(), player), players.end());
-}
-
-bool PlayerManager::init()
+bool inside_target(const SDL_Rect *box, const SDL_Point *position)
 {
-    pm = new PlayerManager();
-    if (pm)
-    {
-        return true;
-    }
-    else
-    {
-        return false;
-    }
+    return box->x < position->x && box->x + box->w > position->x && box->y < position->y &&
+           box->y + box->h > position->y;
 }
-
-bool PlayerManager::destroy()
-{
-    if (pm != nullptr)
-    {
-        delete pm;
-        return true;
-    }
-    else
-    {
-        return false;
-    }
-}
\ No newline at end of file
@@ -1,28 +1,18 @@
 #ifndef _GAMEPLAY_H
 #define _GAMEPLAY_H
 
-#include <random>
 #include <iostream>
-#include <sstream>
 #include <string>
-#include <iostream>
-#include <stdexcept>
 #include <cmath>
 #include <vector>
-#include <assert.h>
-#include <set>
-#include <bitset>
-#include <unordered_set>
-#include <unordered_map>
-#include <boost/uuid/uuid.hpp>
-#include <boost/uuid/uuid_generators.hpp>
-#include <boost/random/mersenne_twister.hpp>
+#include <thread>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_pixels.h>
 #include <SDL2/SDL_render.h>
 #include <SDL2/SDL2_gfxPrimitives.h>
 #include "Events.hpp"
 #include "Wrapper.hpp"
+#include "Simulation.hpp"
 
 SDL_Point operator+(SDL_Point left, SDL_Point right);
 
@@ -73,8 +63,6 @@ struct Layout
             : orientation(orientation_), size(size_), origin(origin_), box(box_) { }
 };
 
-struct Field;
-
 struct Point
 {
     double x;
@@ -178,589 +166,199 @@ struct Point
     Field point_to_field(const Layout *layout) const;
 };
 
-struct Field
-{
-    Sint16 x, y, z;
-
-    Field(Sint16 x_, Sint16 y_, Sint16 z_) : x(x_), y(y_), z(z_)
-    {
-        assert(x + y + z == 0);
-    }
-
-    inline bool operator==(const Field &rhs) const
-    {
-        return (this->x == rhs.x && this->y == rhs.y);
-    }
-
-    inline bool operator!=(const Field &rhs) const
-    {
-        return !(*this == rhs);
-    }
-
-    Field &operator+=(const Field &rhs)
-    {
-        this->x += rhs.x;
-        this->y += rhs.y;
-        this->z += rhs.z;
-        return *this;
-    }
-
-    friend Field operator+(Field lhs, const Field &rhs)
-    {
-        lhs += rhs;
-        return lhs;
-    }
-
-    Field &operator-=(const Field &rhs)
-    {
-        this->x -= rhs.x;
-        this->y -= rhs.y;
-        this->z -= rhs.z;
-        return *this;
-    }
+Point field_to_point(const Field &field, const Layout *layout);
 
-    friend Field operator-(Field lhs, const Field &rhs)
-    {
-        lhs -= rhs;
-        return rhs;
-    }
-
-    Field &operator*=(const Field &rhs)
-    {
-        this->x *= rhs.x;
-        this->y *= rhs.y;
-        this->z *= rhs.z;
-        return *this;
-    }
+std::vector<Point> field_to_polygon_normalized(const Field &field, const Layout *layout);
 
-    friend Field operator*(Field lhs, const Field &rhs)
-    {
-        lhs *= rhs;
-        return rhs;
-    }
+std::vector<Point> field_to_polygon(const Field &field, const Layout *layout);
 
-    Field &operator/=(const Field &rhs)
-    {
-        double x = this->x / rhs.x;
-        double y = this->y / rhs.y;
-        double z = this->z / rhs.z;
-        Field f = cubic_round(x, y, z);
-        *this = f;
-        return *this;
-    }
-
-    friend Field operator/(Field lhs, const Field &rhs)
-    {
-        lhs /= rhs;
-        return lhs;
-    }
-
-    Field &operator*=(const double &rhs)
-    {
-        double x = this->x * rhs;
-        double y = this->y * rhs;
-        double z = this->z * rhs;
-        Field f = cubic_round(x, y, z);
-        *this = f;
-        return *this;
-    }
-
-    friend Field operator*(Field lhs, const double &rhs)
-    {
-        lhs *= rhs;
-        return lhs;
-    }
-
-    Field &operator/=(const double &rhs)
-    {
-        double x = this->x / rhs;
-        double y = this->y / rhs;
-        double z = this->z / rhs;
-        Field f = cubic_round(x, y, z);
-        *this = f;
-        return *this;
-    }
-
-    friend Field operator/(Field lhs, const double &rhs)
-    {
-        lhs /= rhs;
-        return lhs;
-    }
-
-    int operator&(const Field &rhs)
-    {
-        return (abs(this->x - rhs.x) + abs(this->y - rhs.y) + abs(this->z - rhs.z)) / 2;
-    }
-
-    Field get_neighbor(Uint8 direction) const;
-
-    Point field_to_point(const Layout *layout) const;
-
-    std::vector<Point> field_to_polygon_normalized(const Layout *layout) const;
-
-    std::vector<Point> field_to_polygon(const Layout *layout) const;
-
-    std::vector<SDL_Point> field_to_polygon_sdl(const Layout *layout) const;
-
-    static Field cubic_round(double x, double y, double z);
-
-    static Field hex_direction(Uint8 direction);
-};
-
-// from upper right corner
-const std::vector<Field> hex_directions = {{+1, -1, 0},
-                                           {+1, 0,  -1},
-                                           {0,  +1, -1},
-                                           {-1, +1, 0},
-                                           {-1, 0,  +1},
-                                           {0,  -1, +1}};
+std::vector<SDL_Point> field_to_polygon_sdl(const Field &field, const Layout *layout);
 
 Point field_corner_offset(Uint8 corner, const Layout *layout);
 
-namespace std
-{
-    template<>
-    struct hash<Field>
-    {
-        size_t operator()(const Field &f) const
-        {
-            hash<Sint16> int_hash;
-            size_t hx = int_hash(f.x);
-            size_t hy = int_hash(f.y);
-            // hz would be redundant, since f.z is redundant
-            // combine hashes
-            return hx ^ (hy + 0x9e3779b9 + (hx << 6) + (hx >> 2));
-        }
-    };
-}
-
-inline std::ostream &operator<<(std::ostream &os, const Field &rhs)
-{
-    os << "(" << rhs.x << "," << rhs.y << ",";
-    return os;
-}
+SDL_Color to_sdl_color(Color color);
 
-struct Resource
+// topics of the event bus, the field events are published for the cell of the field
+struct FieldChanged
 {
-    Uint32 circle;
-    Uint32 triangle;
-    Uint32 square;
+    FieldMeta *field;
 
-    Resource &operator+=(const Resource &rhs)
-    {
-        this->circle += rhs.circle;
-        this->triangle += rhs.triangle;
-        this->square += rhs.square;
-        return *this;
-    }
-
-    friend Resource operator+(Resource lhs, const Resource &rhs)
-    {
-        lhs += rhs;
-        return lhs;
-    }
-
-    Resource &operator-=(const Resource &rhs)
-    {
-        if (this->circle < rhs.circle)
-            this->circle = 0;
-        else
-            this->circle -= rhs.circle;
-
-        if (this->triangle < rhs.triangle)
-            this->triangle = 0;
-        else
-            this->triangle -= rhs.triangle;
-
-        if (this->square < rhs.square)
-            this->square = 0;
-        else
-            this->square -= rhs.square;
-
-        return *this;
-    }
-
-    friend Resource operator-(Resource lhs, const Resource &rhs)
-    {
-        lhs -= rhs;
-        return lhs;
-    }
-
-    Resource &operator*=(const Resource &rhs)
-    {
-        this->circle *= rhs.circle;
-        this->triangle *= rhs.triangle;
-        this->square *= rhs.square;
-        return *this;
-    }
-
-    friend Resource operator*(Resource lhs, const Resource &rhs)
-    {
-        lhs *= rhs;
-        return lhs;
-    }
-
-    Resource &operator*=(const double rhs)
-    {
-        this->circle *= rhs;
-        this->triangle *= rhs;
-        this->square *= rhs;
-        return *this;
-    }
-
-    friend Resource operator*(const double lhs, Resource rhs)
-    {
-        rhs *= lhs;
-        return rhs;
-    }
-
-    friend Resource operator*(Resource lhs, const double rhs)
-    {
-        return rhs * lhs;
-    }
-
-    bool operator<(const Resource &rhs) const
-    {
-        return (this->circle < rhs.circle || this->triangle < rhs.triangle || this->square < rhs.square);
-    }
-
-    inline bool operator>(const Resource &rhs) const { return rhs < *this; }
-
-    inline bool operator<=(const Resource &rhs) const { return !(*this > rhs); }
-
-    inline bool operator>=(const Resource &rhs) const { return !(*this < rhs); }
-
-    bool operator==(const Resource &rhs) const
-    {
-        return (this->circle == rhs.circle && this->triangle == rhs.triangle && this->square == rhs.square);
-    }
-
-    inline bool operator!=(const Resource &rhs) const { return !(*this == rhs); }
+    static const char *name() { return "FieldChanged"; }
 };
 
-enum Upgrade
+struct FieldUpgraded
 {
-    Regeneration_1,
-    Regeneration_2,
-    Regeneration_3,
-    Reproduction_1,
-    Reproduction_2,
-    Reproduction_3,
-    Offense_1,
-    Offense_2,
-    Offense_3,
-    Defense_1,
-    Defense_2,
-    Defense_3,
-};
-
-const std::vector<Upgrade> UPGRADES = {Regeneration_1, Regeneration_2, Regeneration_3, Reproduction_1, Reproduction_2,
-                                       Reproduction_3, Offense_1, Offense_2, Offense_3, Defense_1, Defense_2, Defense_3
-};
-
-const int NUM_UPGRADES = 12;
-
-typedef std::bitset<NUM_UPGRADES> UpgradeFlags;
-
-namespace std
-{
-    template<>
-    struct hash<Upgrade>
-    {
-        size_t operator()(const Upgrade &f) const
-        {
-            int i = static_cast<int>(f);
-            hash<int> int_hash;
-            return int_hash(f);
-        }
-    };
-}
-
-const std::unordered_map<Upgrade, Resource> UPGRADE_COSTS(
-        {
-                {Regeneration_1, {4,  4,  4}},
-                {Regeneration_2, {8,  8,  8}},
-                {Regeneration_3, {16, 16, 16}},
-                {Reproduction_1, {4,  4,  4}},
-                {Reproduction_2, {8,  8,  8}},
-                {Reproduction_3, {16, 16, 16}},
-                {Offense_1,      {4,  4,  4}},
-                {Offense_2,      {8,  8,  8}},
-                {Offense_3,      {16, 16, 16}},
-                {Defense_1,      {4,  4,  4}},
-                {Defense_2,      {8,  8,  8}},
-                {Defense_3,      {16, 16, 16}}
-        }
-);
-
-const std::unordered_map<Upgrade, std::string> UPGRADE_NAMES(
-        {
-                {Regeneration_1, "Regeneration 1"},
-                {Regeneration_2, "Regeneration 2"},
-                {Regeneration_3, "Regeneration 3"},
-                {Reproduction_1, "Reproduction 1"},
-                {Reproduction_2, "Reproduction 2"},
-                {Reproduction_3, "Reproduction 3"},
-                {Offense_1,      "Offense 1"},
-                {Offense_2,      "Offense 2"},
-                {Offense_3,      "Offense 3"},
-                {Defense_1,      "Defense 1"},
-                {Defense_2,      "Defense 2"},
-                {Defense_3,      "Offense 3"}
-        }
-);
-
-
-const std::unordered_map<Upgrade, std::string> UPGRADE_TEXTS(
-        {
-                {Regeneration_1, "Resources yield 2x their base resources per turn."},
-                {Regeneration_2, "Resources yield 4x their base resources per turn."},
-                {Regeneration_3, "Resources yield 8x their base resources per turn."},
-                {Reproduction_1, "Increase the chance for expanding to a new field at the end of the turn by 5%."},
-                {Reproduction_2, "Increase the chance for expanding to a new field at the end of the turn by 10%."},
-                {Reproduction_3, "Increase the chance for expanding to a new field at the end of the turn by 20%."},
-                {Offense_1,      "Double your offense."},
-                {Offense_2,      "Double your offense."},
-                {Offense_3,      "Double your offense."},
-                {Defense_1,      "Double your defense."},
-                {Defense_2,      "Double your defense."},
-                {Defense_3,      "Double your defense."}
-        }
-);
-
-class FieldMeta;
-
-class Player
-{
-public:
-    Player()
-            : name("Default Player"), uuid(boost::uuids::nil_uuid()) { }
-
-    Player(std::string name_)
-            : name(name_), uuid(boost::uuids::basic_random_generator<boost::mt19937>()())
-    {
-        // use the last 24 bits of the tag for the color
-        boost::uuids::uuid id = this->uuid;
-        uint8_t *data = id.data;
-        this->color = {data[13], data[14], data[15], 0xff};
-    }
-
-    SDL_Color get_color() { return this->color; }
-
-    std::string get_name()
-    {
-        std::ostringstream descriptor;
-        int number = (this->uuid.data[0] << 8) | this->uuid.data[1];
-        descriptor << this->name << " (" << std::hex << number << ")";
-        return descriptor.str();
-    }
-
-    bool fight(FieldMeta *field);
-
-    boost::uuids::uuid get_id() { return this->uuid; }
-
-    inline bool operator==(const Player &rhs) const
-    {
-        return this->uuid == rhs.uuid;
-    }
+    FieldMeta *field;
 
-    inline bool operator!=(const Player &rhs) const
-    {
-        return !(*this == rhs);
-    }
-
-    void handle_event(SDL_Event *event);
-private:
-    boost::uuids::uuid uuid;
-    SDL_Color color;
-    std::string name;
+    static const char *name() { return "FieldUpgraded"; }
 };
 
-class Grid;
-
-class HexagonGrid;
-
-class FieldMeta
+// inside is false if the mouse left the grid, field is the last marked one then
+struct MarkerMoved
 {
-public:
-    FieldMeta(HexagonGrid *grid_, Field field_, Player &owner_)
-            : grid(grid_), field(field_), owner(owner_), changed(true)
-    {
-        this->upgrades = 0;
-        static std::random_device rd;
-        std::mt19937 rng(rd());
-        std::uniform_int_distribution<Uint8> distro(0, 1);
-        this->resources_base.circle = distro(rng);
-        this->resources_base.triangle = distro(rng);
-        this->resources_base.square = distro(rng);
-        this->offense = 0;
-        this->defense = 0;
-        this->regenerate_resources();
-    }
-
-    HexagonGrid *get_grid() { return this->grid; }
+    FieldMeta *field;
+    bool inside;
 
-    int get_offense()
-    {
-        int factor = 1;
-        if (this->get_upgrades()[Offense_1])
-            factor *= 2;
-        if (this->get_upgrades()[Offense_2])
-            factor *= 2;
-        if (this->get_upgrades()[Offense_3])
-            factor *= 2;
-        return this->offense * factor;
-    }
-
-    int get_defense()
-    {
-        int factor = 1;
-        if (this->upgrades[Defense_1])
-            factor *= 2;
-        if (this->get_upgrades()[Defense_2])
-            factor *= 2;
-        if (this->get_upgrades()[Defense_3])
-            factor *= 2;
-        return this->offense * factor;
-    }
-
-    void set_offense(int off) { this->offense = off; }
-    void set_defense(int def) { this->defense = def; }
-    Field get_field() { return this->field; }
-
-    Player &get_owner() { return this->owner; }
-
-    void set_owner(Player &player) { this->owner = player; }
-    void load(SDL_Renderer *renderer, Layout *layout);
-    Resource get_resources() { return this->resources; }
-    UpgradeFlags get_upgrades() { return this->upgrades; }
-    void consume_resources(Resource costs);
-    void regenerate_resources();
-    bool upgrade(Upgrade upgrade);
-    void handle_event(const SDL_Event *event);
-    FieldMeta *get_neighbor(Uint8 direction);
-    double get_reproduction()
-    {
-        return upgrades[Reproduction_1] * 0.05 + upgrades[Reproduction_2] * 0.1 + upgrades[Reproduction_3] * 0.2 + 0.01;
-    }
-private:
-    bool changed;
-    const Field field;
-    HexagonGrid *grid;
-    Player owner;
-    UpgradeFlags upgrades;
-    Resource resources_base; // without upgrades applied, used as basis of regeneration
-    Resource resources; // actual current resources
-    int offense;
-    int defense;
+    static const char *name() { return "MarkerMoved"; }
 };
 
-typedef std::unordered_set<FieldMeta *> Cluster;
-
-class HexagonGrid;
-
-class PlayerManager
+struct FieldSelected
 {
-public:
-    PlayerManager()
-    {
-        players = std::vector<Player>();
-        current_player = players.begin();
-        default_player = Player();
-    }
-
-    Player &get_current();
-
-    void next_turn();
-
-    void shuffle();
-
-    void surrender(Player &player, HexagonGrid *grid);
-
-    void add_player(Player &player);
-
-    long get_num_players() { return players.size(); }
+    FieldMeta *field;
 
-    Player default_player;
-    static PlayerManager *pm;
-
-    static bool init();
-
-    static bool destroy();
-
-private:
-    std::vector<Player> players;
-    std::vector<Player>::iterator current_player;
+    static const char *name() { return "FieldSelected"; }
 };
 
-class HexagonGrid
+// presentation of a grid, renders the fields and handles input on them
+class HexagonGrid : public Grid
 {
 public:
-    HexagonGrid(Sint16 grid_radius, Layout *layout_, Renderer *renderer_)
-            : layout(layout_), radius(grid_radius), renderer(renderer_)
+    HexagonGrid(Sint16 grid_radius, Layout *layout_, Renderer *renderer_, EventBus *bus_, uint64_t seed)
+            : Grid(grid_radius, PlayerManager::pm->get_registry(), seed), renderer(renderer_), bus(bus_),
+              layout(layout_)
     {
         this->attack_marker = nullptr;
         this->texture = nullptr;
+        this->texture_size = {0, 0};
+        this->scroll = {0, 0};
+        this->scrolled = {0, 0};
+        this->draw_offset = {0, 0};
+        this->atlas = nullptr;
+        this->atlas_size = 0;
+        this->sprite_size = 0;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+        this->image = nullptr;
+#endif
+        this->set_detail(12, 6, 4);
         this->panning = false;
-        std::unordered_map<Field, FieldMeta *> fields = std::unordered_map<Field, FieldMeta *>();
-        // first lower half, then upper half
-        Field new_field = {0, 0, 0};
-        for (Sint16 x = -grid_radius; x <= grid_radius; x++)
-        {
-            Sint16 y_l = (-grid_radius > -x - grid_radius) ? -grid_radius : -x - grid_radius;
-            Sint16 y_u = (grid_radius < -x + grid_radius) ? grid_radius : -x + grid_radius;
-            for (Sint16 y = y_l; y <= y_u; y++)
-            {
-                Sint16 z = -x - y;
-                new_field = {x, y, z};
-                FieldMeta *meta = new FieldMeta(this, new_field, PlayerManager::pm->default_player);
-                this->fields.insert({new_field, meta});
-            }
-        }
-        this->marker = new FieldMeta(this, new_field, PlayerManager::pm->default_player);
-        this->load();
+        this->dirty_marks.assign(this->fields.size(), false);
+        this->changed_marks.assign(this->fields.size(), false);
+        this->marker_pending = false;
+        this->all_changed = false;
+        this->set_threads(std::thread::hardware_concurrency());
+        this->marker = &(this->fields.back());
+        this->changed = true; // loaded on the first render
     }
 
     ~HexagonGrid()
     {
-        for (auto const &elem : this->fields)
-        {
-            delete elem.second;
-        }
+        SDL_DestroyTexture(this->atlas);
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+        SDL_DestroyTexture(this->image);
+#endif
         SDL_DestroyTexture(this->texture);
     }
-    FieldMeta *get_neighbor(FieldMeta *field, Uint8 direction);
-    Cluster get_cluster(FieldMeta *field);
+
+    // brings the texture or vertex buffer up to date and adds the areas that look different to damage
+    void prepare(Damage *damage);
+    // draws the state of the last prepare, may be called several times with different clip rects
     void render(Renderer *renderer);
     void load();
     Sint16 get_radius() { return radius * layout->size; }
     void move(SDL_Point move);
     void update_marker();
+    // publishes the changes collected since the last call, once per frame
+    void flush_events();
     void update_dimensions(SDL_Point dimensions);
-    Resource get_resources_of_cluster(Cluster *cluster);
-    Resource consume_resources_of_cluster(Cluster *cluster, Resource costs);
     FieldMeta *point_to_field(const Point p);
     Point field_to_point(FieldMeta *field);
-    FieldMeta *get_field(Field field);
     void handle_event(SDL_Event *event);
 
-    bool place(Player &player, FieldMeta *center);
     void set_selecting(bool state) { this->placing = state; }
+
+    // level of detail: below these layout sizes resource glyphs and then outlines are left out,
+    // below image the map is drawn as an image with a texel per field (not available before SDL 2.0.18)
+    void set_detail(Sint16 glyphs, Sint16 outlines, Sint16 image_)
+    {
+        this->lod_glyphs = glyphs;
+        this->lod_outlines = outlines;
+        this->lod_image = image_;
+        this->changed = true;
+    }
     FieldMeta *get_attack_marker() { return this->attack_marker; }
 
-    void free(Player &player);
+    void field_changed(FieldMeta *field);
+    void all_fields_changed();
+    void field_upgraded(FieldMeta *field);
+    void owner_changed(FieldMeta *field);
 private:
-    bool changed;
+    bool changed; // the whole texture has to be redrawn, e.g. after zooming
+    Sint16 lod_glyphs;
+    Sint16 lod_outlines;
+    Sint16 lod_image;
+    // fields to redraw on the next render, if nothing else changed
+    std::vector<uint32_t> dirty;
+    std::vector<bool> dirty_marks;
+    void mark_dirty(FieldMeta *meta);
+    std::vector<FieldMeta *> visible; // scratch space for load
+    // the texture has the size of the box and is used as a ring buffer, panning only moves scroll
+    // and redraws the strips that came into view
+    SDL_Point texture_size;
+    SDL_Point scroll; // position of the box's top left corner in the texture
+    SDL_Point scrolled; // panned since the last render
+    SDL_Point draw_offset; // from the box to the texture, applied by copy_sprite
+    void load_scrolled();
+    void load_region(SDL_Rect area);
+    // pre-rendered white sprites, colored when copied, rebuilt whenever the layout size changes
+    enum Sprite
+    {
+        SpriteFill,
+        SpriteOutline,
+        SpriteTriangle,
+        SpriteCircle,
+        SpriteSquare
+    };
+    SDL_Texture *atlas;
+    Sint16 atlas_size; // size of the fields the atlas is for
+    Sint16 sprite_size; // size of the hexagons in the atlas, smaller than the fields if they don't fit a texture
+    void load_atlas();
+    SDL_Rect sprite_rect(Sprite sprite);
+    void copy_sprite(Sprite sprite, FieldMeta *meta);
+    SDL_Color field_color(FieldMeta *meta);
+    void load_resources(FieldMeta *meta);
+    void load_marker();
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    // all visible fields in one vertex buffer, every field owns a fixed slot that is rewritten when it is dirty,
+    // panning moves the vertices and hands the slots of the fields leaving the view to those coming into it
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+    std::vector<int32_t> slots; // slot of every field, -1 if it isn't visible
+    std::vector<int32_t> slot_fields; // field in every slot, -1 if the slot is free
+    std::vector<int32_t> free_slots;
+    std::vector<Point> corners; // corner offsets for the current layout size
+    void load_geometry();
+    void load_geometry_scrolled();
+    void load_geometry_indices();
+    void load_geometry_field(FieldMeta *meta);
+    void clear_geometry_slot(int32_t slot);
+    void load_geometry_marker();
+    SDL_FPoint sprite_coordinate(Sprite sprite, double x, double y);
+    SDL_Texture *image;
+    std::vector<Uint32> image_pixels;
+    void load_image_field(FieldMeta *meta);
+    void load_image();
+    void render_image(Renderer *renderer);
+#endif
     bool placing;
     FieldMeta *attack_marker;
     Renderer *renderer;
+    EventBus *bus;
+    // a round changes every field, the changes and marker moves are merged until the next flush
+    std::vector<uint32_t> changed_cells;
+    std::vector<bool> changed_marks;
+    bool all_changed;
+    MarkerMoved pending_marker;
+    bool marker_pending;
     SDL_Texture *texture;
-    std::unordered_map<Field, FieldMeta *> fields;
     Layout *layout;
     FieldMeta *marker;
     bool panning;
-    Sint16 radius;
     bool on_rectangle(SDL_Rect *rect);
+    // fields with their center inside rect, visits only the rows and columns that can reach it
+    // found may be nullptr to stop at the first field
+    bool fields_in_rect(const SDL_Rect *rect, std::vector<FieldMeta *> *found);
+    SDL_Rect get_bounds();
+    SDL_Rect field_rect(FieldMeta *meta); // bounding box of the hexagon
 };
 
 bool inside_target(const SDL_Rect *target, const SDL_Point *position);
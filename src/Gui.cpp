@@ -1,5 +1,10 @@
 #include "Gui.hpp"
 
+// SDL_ttf 2.0.18 looks glyphs up by any codepoint, older versions by the basic multilingual plane only
+#if SDL_VERSIONNUM(SDL_TTF_MAJOR_VERSION, SDL_TTF_MINOR_VERSION, SDL_TTF_PATCHLEVEL) >= SDL_VERSIONNUM(2, 0, 18)
+#define BOB_TTF_GLYPHS_32
+#endif
+
 SDL_Color operator!(const SDL_Color &color)
 {
     Uint8 r = (Uint8) 0xff - color.r;
@@ -19,84 +24,303 @@ TTF_Font *load_font_from_file(std::string path_to_file, int size)
     return font;
 }
 
-void TextBox::load()
+void GlyphAtlas::clear()
 {
-    this->renderer->set_draw_color({0, 0, 0, 0xff});
-    if (this->text.size() < 1)
+    this->glyphs.clear();
+    this->cursor = {0, 0};
+    this->shelf_height = 0;
+    this->generation++;
+}
+
+bool GlyphAtlas::grow()
+{
+    int limit = GlyphAtlas::MAX_SIZE;
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(this->renderer->get_renderer(), &info) == 0)
     {
-        this->text += " ";
+        if (info.max_texture_width > 0)
+            limit = std::min(limit, info.max_texture_width);
+        if (info.max_texture_height > 0)
+            limit = std::min(limit, info.max_texture_height);
     }
-    const char *displayed_text = this->text.c_str();
-    SDL_Surface *text_surface = TTF_RenderUTF8_Blended_Wrapped(this->font, displayed_text, this->color,
-                                                               this->dimensions.w);
-    if (text_surface == nullptr)
+    if (2 * this->size > limit)
+        return false;
+    this->size *= 2;
+    SDL_DestroyTexture(this->texture);
+    this->texture = nullptr;
+    this->clear();
+    return true;
+}
+
+// false if SDL_ttf can't look the glyph up
+static bool glyph_metrics(TTF_Font *font, Uint32 codepoint, int *minx, int *advance)
+{
+    int maxx, miny, maxy;
+#ifdef BOB_TTF_GLYPHS_32
+    return TTF_GlyphMetrics32(font, codepoint, minx, &maxx, &miny, &maxy, advance) == 0;
+#else
+    return codepoint <= 0xffff && TTF_GlyphMetrics(font, (Uint16) codepoint, minx, &maxx, &miny, &maxy, advance) == 0;
+#endif
+}
+
+// added to the pen between the two glyphs, like TTF_RenderUTF8_Blended_Wrapped does
+static int glyph_kerning(TTF_Font *font, Uint32 previous, Uint32 codepoint)
+{
+    int kerning = 0;
+#ifdef BOB_TTF_GLYPHS_32
+    kerning = TTF_GetFontKerningSizeGlyphs32(font, previous, codepoint);
+#else
+    if (previous <= 0xffff && codepoint <= 0xffff)
+        kerning = TTF_GetFontKerningSizeGlyphs(font, (Uint16) previous, (Uint16) codepoint);
+#endif
+    // -1 is an error
+    return kerning == -1 ? 0 : kerning;
+}
+
+const GlyphAtlas::Glyph *GlyphAtlas::get(TTF_Font *font, Uint32 codepoint, const std::string &bytes)
+{
+    auto found = this->glyphs.find({font, codepoint});
+    if (found != this->glyphs.end())
+        return &(found->second);
+    SDL_Surface *rendered = TTF_RenderUTF8_Blended(font, bytes.c_str(), {0xff, 0xff, 0xff, 0xff});
+    if (rendered == nullptr)
     {
-        SDL_FreeSurface(text_surface);
         throw SDL_TTFException();
     }
-    this->dimensions.h = text_surface->h;
-    SDL_Surface *surface = SDL_CreateRGBSurface(0, this->dimensions.w, text_surface->h, 32, rmask, gmask, bmask,
-                                                amask);
-    if (surface == nullptr || SDL_LockSurface(surface) < 0 ||
-        SDL_FillRect(surface, nullptr, SDL_MapRGB(surface->format, 255, 255, 255)) < 0)
+    SDL_Surface *surface = SDL_ConvertSurfaceFormat(rendered, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(rendered);
+    if (surface == nullptr || surface->w > this->size || surface->h > this->size)
+    {
+        SDL_FreeSurface(surface);
+        throw SDL_Exception("Failed to convert glyph for the atlas!");
+    }
+    if (this->cursor.x + surface->w > this->size)
+    {
+        this->cursor = {0, this->cursor.y + this->shelf_height + 1};
+        this->shelf_height = 0;
+    }
+    if (this->cursor.y + surface->h > this->size)
+    {
+        // full, start over with the glyphs in use from now on, the text laid out before has to be laid out again
+        if (this->generation == this->frame_generation)
+        {
+            this->clear();
+        }
+        else if (!this->grow())
+        {
+            SDL_FreeSurface(surface);
+            return nullptr;
+        }
+    }
+    if (this->texture == nullptr)
+    {
+        this->texture = SDL_CreateTexture(this->renderer->get_renderer(), SDL_PIXELFORMAT_ARGB8888,
+                                          SDL_TEXTUREACCESS_STATIC, this->size, this->size);
+        if (this->texture == nullptr)
+        {
+            SDL_FreeSurface(surface);
+            throw SDL_TextureException();
+        }
+        SDL_SetTextureBlendMode(this->texture, SDL_BLENDMODE_BLEND);
+    }
+    SDL_Rect source = {this->cursor.x, this->cursor.y, surface->w, surface->h};
+    if (SDL_UpdateTexture(this->texture, &source, surface->pixels, surface->pitch) < 0)
+    {
+        SDL_FreeSurface(surface);
+        throw SDL_TextureException();
+    }
+    this->cursor.x += surface->w + 1;
+    this->shelf_height = std::max(this->shelf_height, surface->h);
+    SDL_FreeSurface(surface);
+    // the rendered glyph starts at the pen, or at its left bearing if that is negative
+    int minx = 0;
+    int advance = source.w;
+    if (!glyph_metrics(font, codepoint, &minx, &advance))
+    {
+        minx = 0;
+        advance = source.w;
+    }
+    Glyph &glyph = this->glyphs[{font, codepoint}];
+    glyph = {source, std::min(minx, 0), advance};
+    return &glyph;
+}
+
+// length of the UTF-8 sequence starting with lead, invalid bytes count as one character
+static size_t utf8_length(unsigned char lead)
+{
+    if ((lead >> 5) == 0x6)
+        return 2;
+    if ((lead >> 4) == 0xe)
+        return 3;
+    if ((lead >> 3) == 0x1e)
+        return 4;
+    return 1;
+}
+
+static Uint32 utf8_codepoint(const std::string &bytes)
+{
+    static const unsigned char lead_masks[] = {0xff, 0x1f, 0x0f, 0x07};
+    Uint32 codepoint = (unsigned char) bytes[0] & lead_masks[bytes.size() - 1];
+    for (size_t i = 1; i < bytes.size(); i++)
     {
-        throw SDL_Exception("Failed to fill rect behind text!");
+        codepoint = (codepoint << 6) | ((unsigned char) bytes[i] & 0x3f);
     }
-    SDL_UnlockSurface(surface);
-    if (SDL_BlitSurface(text_surface, nullptr, surface, nullptr) < 0)
+    return codepoint;
+}
+
+void TextBox::load()
+{
+    if (this->text.size() < 1)
     {
-        throw SDL_Exception("Failed to create background text_surface!");
+        this->text += " ";
     }
-    if (this->texture != nullptr)
+    int line_skip = TTF_FontLineSkip(this->font);
+    SDL_Point pen;
+    this->rendered = false;
+    do
     {
-        SDL_DestroyTexture(this->texture);
+        // the atlas may run full while laying out, then everything taken so far is invalid,
+        // it grows before it clears twice in a frame, so this ends after a few passes
+        this->layout_generation = this->glyphs->get_generation();
+        this->layout.clear();
+        pen = {0, 0};
+        Uint32 previous = 0; // codepoint of the glyph before on the line
+        size_t line_start = 0; // first glyph of the current line
+        size_t wrap = 0; // glyph after the last space
+        for (size_t i = 0; i < this->text.size();)
+        {
+            size_t length = std::min(utf8_length(this->text[i]), this->text.size() - i);
+            std::string bytes = this->text.substr(i, length);
+            i += length;
+            if (bytes == "\n")
+            {
+                pen = {0, pen.y + line_skip};
+                previous = 0;
+                line_start = this->layout.size();
+                continue;
+            }
+            Uint32 codepoint = utf8_codepoint(bytes);
+            const GlyphAtlas::Glyph *glyph = this->glyphs->get(this->font, codepoint, bytes);
+            if (glyph == nullptr)
+            {
+                // not even the biggest atlas holds the text
+                this->layout.clear();
+                this->render_text();
+                return;
+            }
+            if (previous != 0)
+                pen.x += glyph_kerning(this->font, previous, codepoint);
+            previous = codepoint;
+            if (pen.x > 0 && pen.x + glyph->offset + glyph->source.w > this->dimensions.w)
+            {
+                // wrapped at the last space like TTF_RenderUTF8_Blended_Wrapped, inside the word without one
+                size_t first = wrap > line_start ? wrap : this->layout.size();
+                int shift = first < this->layout.size() ? this->layout[first].pen : pen.x;
+                for (size_t k = first; k < this->layout.size(); k++)
+                {
+                    this->layout[k].target.x -= shift;
+                    this->layout[k].target.y += line_skip;
+                    this->layout[k].pen -= shift;
+                }
+                pen = {pen.x - shift, pen.y + line_skip};
+                line_start = first;
+            }
+            this->layout.push_back({glyph->source,
+                                    {pen.x + glyph->offset, pen.y, glyph->source.w, glyph->source.h}, pen.x});
+            pen.x += glyph->advance;
+            if (bytes == " ")
+                wrap = this->layout.size();
+        }
+    } while (this->layout_generation != this->glyphs->get_generation());
+    this->dimensions.h = pen.y + line_skip;
+}
+
+void TextBox::render_text()
+{
+    SDL_Surface *surface = TTF_RenderUTF8_Blended_Wrapped(this->font, this->text.c_str(), this->color,
+                                                          this->dimensions.w);
+    if (surface == nullptr)
+    {
+        throw SDL_TTFException();
     }
-    SDL_SetRenderTarget(this->renderer->get_renderer(), this->texture);
+    this->dimensions.h = surface->h;
+    SDL_DestroyTexture(this->texture);
     this->texture = SDL_CreateTextureFromSurface(this->renderer->get_renderer(), surface);
-    SDL_FreeSurface(text_surface);
     SDL_FreeSurface(surface);
     if (this->texture == nullptr)
     {
-        SDL_DestroyTexture(this->texture);
         throw SDL_TextureException();
     }
-    SDL_SetRenderTarget(this->renderer->get_renderer(), nullptr); // reset the render target
+    this->rendered = true;
 }
 
-void Container::handle_event(SDL_Event *event)
+void TextBox::prepare(Damage *damage)
 {
-    for (auto box : this->elements)
-        box->handle_event(event);
+    if (!this->rendered && this->layout_generation != this->glyphs->get_generation())
+    {
+        this->changed = true;
+    }
+    Box::prepare(damage);
 }
 
-void FieldBox::handle_event(const SDL_Event *event)
+void TextBox::render(Renderer *ext_renderer)
 {
-    if (event->type == BOB_FIELDUPDATEEVENT)
+    ScopedTimer timer("box render");
+    if (this->visible)
     {
-        FieldMeta *field_update = reinterpret_cast<FieldMeta *>(event->user.data1);
-        if (field_update == this->field)
+        // a quad per glyph on the white background, no texture is rasterized for the text
+        ext_renderer->set_draw_color({0xff, 0xff, 0xff, 0xff});
+        ext_renderer->fill_rect(&(this->dimensions));
+        if (this->rendered)
         {
-            changed = true;
+            SDL_Rect target = this->dimensions;
+            SDL_QueryTexture(this->texture, nullptr, nullptr, &(target.w), &(target.h));
+            ext_renderer->copy(this->texture, nullptr, &target);
+            return;
+        }
+        SDL_Texture *atlas = this->glyphs->get_texture();
+        SDL_SetTextureColorMod(atlas, this->color.r, this->color.g, this->color.b);
+        for (PlacedGlyph &placed : this->layout)
+        {
+            SDL_Rect target = placed.target;
+            target.x += this->dimensions.x;
+            target.y += this->dimensions.y;
+            ext_renderer->copy(atlas, &(placed.source), &target);
         }
     }
-    else if (event->type == BOB_MARKERUPDATE)
+}
+
+void Container::handle_event(SDL_Event *event)
+{
+    for (auto box : this->elements)
+        box->handle_event(event);
+}
+
+void FieldBox::show(FieldMeta *field)
+{
+    if (field != this->field || this->subscription == 0)
     {
-        FieldMeta *field_update = reinterpret_cast<FieldMeta *>(event->user.data1);
-        this->field = field_update;
-        this->update();
-        SDL_Point mouse;
-        SDL_GetMouseState(&mouse.x, &mouse.y);
-        this->update_position(mouse);
-        this->visible = true;
-        changed = true;
+        this->bus->unsubscribe(this->subscription);
+        this->field = field;
+        this->subscription = this->bus->subscribe<FieldChanged>(field->get_grid()->get_index(field),
+                                                                [this](const FieldChanged &)
+                                                                {
+                                                                    this->update();
+                                                                });
     }
+    this->update();
+    SDL_Point mouse;
+    SDL_GetMouseState(&mouse.x, &mouse.y);
+    this->update_position(mouse);
+    this->visible = true;
+    changed = true;
 }
 
 void FieldBox::update()
 {
-    HexagonGrid *grid = this->field->get_grid();
-    Cluster cluster = grid->get_cluster(this->field);
-    Resource cluster_resources = grid->get_resources_of_cluster(&cluster);
+    Grid *grid = this->field->get_grid();
+    Cluster *cluster = grid->get_cluster(this->field);
+    Resource cluster_resources = grid->get_resources_of_cluster(cluster);
     Resource field_resources = this->field->get_resources();
     std::ostringstream output;
     output << this->field->get_owner().get_name() << "\n"
@@ -138,12 +362,7 @@ void UpgradeBox::handle_event(const SDL_Event *event)
 {
     if (this->visible)
     {
-        if (event->type == BOB_FIELDUPDATEEVENT)
-        {
-            this->update_upgrade_boxes();
-            changed = true;
-        }
-        else if (event->type == SDL_MOUSEBUTTONDOWN)
+        if (event->type == SDL_MOUSEBUTTONDOWN)
         {
             SDL_Point mouse;
             SDL_GetMouseState(&mouse.x, &mouse.y);
@@ -181,24 +400,34 @@ void UpgradeBox::handle_event(const SDL_Event *event)
             changed = true;
         }
     }
-    else // NOT visible
+}
+
+void UpgradeBox::select(FieldMeta *selected)
+{
+    if (this->visible || selected == nullptr || Timer::MOUSE_LOCKED)
+        return;
+    Timer::MOUSE_LOCKED = true;
+    SDL_Point mouse;
+    SDL_GetMouseState(&mouse.x, &mouse.y);
+    this->update_position(mouse);
+    this->field = selected;
+    // the buttons follow the field while the box is open
+    Uint32 cell = selected->get_grid()->get_index(selected);
+    this->bus->unsubscribe(this->changed_subscription);
+    this->bus->unsubscribe(this->upgraded_subscription);
+    this->changed_subscription = this->bus->subscribe<FieldChanged>(cell, [this](const FieldChanged &)
     {
-        if (event->type == BOB_FIELDSELECTEDEVENT)
-        {
-            FieldMeta *selected = static_cast<FieldMeta *>(event->user.data1);
-            if (selected != nullptr && event->user.code == 0x0 && !Timer::MOUSE_LOCKED)
-            {
-                Timer::MOUSE_LOCKED = true;
-                SDL_Point mouse;
-                SDL_GetMouseState(&mouse.x, &mouse.y);
-                this->update_position(mouse);
-                this->field = selected;
-                this->update_upgrade_boxes();
-                this->set_visible(true);
-                changed = true;
-            }
-        }
-    }
+        if (this->visible)
+            this->update_upgrade_boxes();
+    });
+    this->upgraded_subscription = this->bus->subscribe<FieldUpgraded>(cell, [this](const FieldUpgraded &)
+    {
+        if (this->visible)
+            this->update_upgrade_boxes();
+    });
+    this->update_upgrade_boxes();
+    this->set_visible(true);
+    changed = true;
 }
 
 void UpgradeButtonBox::handle_event(const SDL_Event *event)
@@ -219,18 +448,35 @@ void UpgradeButtonBox::handle_event(const SDL_Event *event)
     }
 }
 
-void UpgradeBox::render(Renderer *ext_renderer)
+void UpgradeBox::prepare(Damage *damage)
 {
-    this->upgrade_info->render(ext_renderer);
+    this->upgrade_info->prepare(damage);
     for (auto box : this->upgrades)
     {
-        box->render(ext_renderer);
+        box->prepare(damage);
     }
     this->changed = false;
     this->dimensions = this->upgrades[0]->get_dimensions();
     this->dimensions.h *= this->upgrades.size();
 }
 
+void UpgradeBox::render(Renderer *ext_renderer)
+{
+    this->upgrade_info->render(ext_renderer);
+    for (auto box : this->upgrades)
+    {
+        box->render(ext_renderer);
+    }
+}
+
+void Container::prepare(Damage *damage)
+{
+    for (auto info_box : this->elements)
+    {
+        info_box->prepare(damage);
+    }
+}
+
 void Container::render(Renderer *renderer)
 {
     for (auto info_box : this->elements)
@@ -239,17 +485,40 @@ void Container::render(Renderer *renderer)
     }
 }
 
-void Box::render(Renderer *ext_renderer)
+void Box::prepare(Damage *damage)
 {
-    if (changed)
+    ScopedTimer timer("box prepare");
+    bool changed_content = this->changed;
+    if (changed_content)
     {
         this->load();
     }
+    // the frame was scrolled under the box, what it looked like moved along
+    SDL_Rect scroll_area = damage->get_scroll_area();
+    SDL_Point scrolled = damage->get_scrolled();
+    bool scrolled_under = this->drawn_visible && SDL_HasIntersection(&(this->drawn), &scroll_area);
+    if (changed_content || scrolled_under || this->visible != this->drawn_visible
+        || !SDL_RectEquals(&(this->dimensions), &(this->drawn)))
+    {
+        if (this->drawn_visible)
+            damage->add(this->drawn);
+        if (scrolled_under)
+            damage->add({this->drawn.x + scrolled.x, this->drawn.y + scrolled.y, this->drawn.w, this->drawn.h});
+        if (this->visible)
+            damage->add(this->dimensions);
+    }
+    this->drawn = this->dimensions;
+    this->drawn_visible = this->visible;
+    this->changed = false;
+}
+
+void Box::render(Renderer *ext_renderer)
+{
+    ScopedTimer timer("box render");
     if (this->visible && this->texture != nullptr)
     {
         ext_renderer->copy(this->texture, nullptr, &(this->dimensions));
     }
-    this->changed = false;
 }
 
 void Container::set_visible(bool visible)
@@ -382,17 +651,14 @@ void TextInputBox::prompt(std::string message)
     this->changed = true;
 }
 
+void TextInputBox::prepare(Damage *damage)
+{
+    TextBox::prepare(damage);
+}
+
 void TextInputBox::render(Renderer *ext_renderer)
 {
-    if (this->changed)
-    {
-        this->load();
-    }
-    if (this->texture != nullptr && this->visible)
-    {
-        ext_renderer->copy(this->texture, nullptr, &(this->dimensions));
-    }
-    this->changed = false;
+    TextBox::render(ext_renderer);
 }
 
 void TextInputBox::update_dimensions(SDL_Rect rect)
@@ -5,6 +5,8 @@
 #include "SDL2/SDL_ttf.h"
 #include <stdio.h>
 #include <string>
+#include <map>
+#include <vector>
 #include <cmath>
 #include <iostream>
 #include <sstream>
@@ -13,7 +15,64 @@
 #include "Gameplay.hpp"
 #include "Events.hpp"
 #include "Wrapper.hpp"
-#include "Pixelmask.h"
+
+// white glyphs of all fonts in one texture, colored when copied, a font pointer stands for font and size
+class GlyphAtlas
+{
+public:
+    struct Glyph
+    {
+        SDL_Rect source; // in the atlas
+        int offset; // from the pen to the left edge of the source, negative if the glyph reaches back
+        int advance;
+    };
+
+    GlyphAtlas(Renderer *renderer_)
+            : renderer(renderer_)
+    {
+        this->texture = nullptr;
+        this->generation = 0;
+        this->size = GlyphAtlas::MIN_SIZE;
+        this->clear();
+        this->frame_generation = this->generation;
+    }
+
+    ~GlyphAtlas()
+    {
+        SDL_DestroyTexture(this->texture);
+    }
+
+    // bytes is the UTF-8 encoding of codepoint, the glyph is rasterized on the first use only,
+    // nullptr if the glyphs of this frame don't fit into the biggest atlas
+    const Glyph *get(TTF_Font *font, Uint32 codepoint, const std::string &bytes);
+
+    SDL_Texture *get_texture() { return this->texture; }
+
+    // changes whenever the atlas ran full and was cleared, glyphs taken before are invalid then
+    Uint32 get_generation() { return this->generation; }
+
+    // the first time the atlas runs full in a frame it drops the glyphs of earlier frames,
+    // the next time the glyphs of the frame don't fit and it grows instead
+    void begin_frame() { this->frame_generation = this->generation; }
+
+    static const int MIN_SIZE = 512;
+    static const int MAX_SIZE = 2048;
+private:
+    Renderer *renderer;
+    SDL_Texture *texture;
+    int size; // width and height
+    std::map<std::pair<TTF_Font *, Uint32>, Glyph> glyphs;
+    Uint32 generation;
+    Uint32 frame_generation; // as of the start of the frame
+    // glyphs are packed into shelves, left to right and top to bottom
+    SDL_Point cursor;
+    int shelf_height;
+
+    void clear();
+
+    // doubles the size and clears the atlas, false if it's as big as it gets
+    bool grow();
+};
 
 class Box
 {
@@ -23,6 +82,8 @@ public:
     {
         this->texture = nullptr;
         this->visible = false;
+        this->drawn = {0, 0, 0, 0};
+        this->drawn_visible = false;
     }
 
     virtual ~Box()
@@ -32,12 +93,17 @@ public:
 
     virtual void update_position(SDL_Point dimensions);
 
+    // loads the changed content and adds where the box was and is now to damage if it looks different
+    virtual void prepare(Damage *damage);
+
     virtual void render(Renderer *renderer);
 
     virtual void load() { this->changed = false; }
 
     virtual void set_visible(bool visibility) { this->visible = visibility; }
 
+    bool get_visible() { return this->visible; }
+
     SDL_Rect get_dimensions() { return this->dimensions; }
 
     virtual void handle_event(const SDL_Event *event) = 0;
@@ -48,19 +114,28 @@ protected:
     SDL_Color color;
     bool visible;
     bool changed;
+    // as of the last prepare
+    SDL_Rect drawn;
+    bool drawn_visible;
 };
 
+// text drawn from the glyph atlas, only the layout is redone when the text changes
 class TextBox : public Box
 {
 public:
-    TextBox(Renderer *renderer, SDL_Rect dimensions, SDL_Color color, TTF_Font *font_)
-            : Box(renderer, dimensions, color), font(font_), lines(1)
+    TextBox(Renderer *renderer, SDL_Rect dimensions, SDL_Color color, TTF_Font *font_, GlyphAtlas *glyphs_)
+            : Box(renderer, dimensions, color), font(font_), glyphs(glyphs_), lines(1)
     {
+        this->rendered = false;
         this->load();
     }
 
     void load();
 
+    void prepare(Damage *damage);
+
+    void render(Renderer *renderer);
+
     void load_text(std::string text)
     {
         this->text = text;
@@ -71,15 +146,29 @@ public:
 
 protected:
     TTF_Font *font;
+    GlyphAtlas *glyphs;
     Uint16 lines;
     std::string text;
+    // glyphs of the text, the targets are relative to the box
+    struct PlacedGlyph
+    {
+        SDL_Rect source;
+        SDL_Rect target;
+        int pen; // x of the pen at the glyph, the target is offset from it
+    };
+    std::vector<PlacedGlyph> layout;
+    Uint32 layout_generation;
+    // the text is rendered into the box's texture instead if its glyphs don't fit into the atlas at all
+    bool rendered;
+
+    void render_text();
 };
 
 class TextInputBox : TextBox
 {
 public:
-    TextInputBox(Renderer *renderer_, SDL_Rect dimensions_, SDL_Color color_, TTF_Font *font_)
-            : TextBox(renderer_, dimensions_, color_, font_), input("")
+    TextInputBox(Renderer *renderer_, SDL_Rect dimensions_, SDL_Color color_, TTF_Font *font_, GlyphAtlas *glyphs_)
+            : TextBox(renderer_, dimensions_, color_, font_, glyphs_), input("")
     {
         this->visible = false;
         this->output << PlayerManager::pm->get_current().get_name() << "# ";
@@ -95,6 +184,8 @@ public:
 
     void handle_event(const SDL_Event *event);
 
+    void prepare(Damage *damage);
+
     void render(Renderer *ext_renderer);
 
     void update_dimensions(SDL_Rect rect);
@@ -111,17 +202,29 @@ private:
 class FieldBox : public TextBox
 {
 public:
-    FieldBox(Renderer *renderer, SDL_Rect dimensions, SDL_Color color, TTF_Font *font, FieldMeta *field_)
-            : TextBox(renderer, dimensions, color, font), field(field_) { }
+    FieldBox(Renderer *renderer, SDL_Rect dimensions, SDL_Color color, TTF_Font *font, GlyphAtlas *glyphs,
+             EventBus *bus_, FieldMeta *field_)
+            : TextBox(renderer, dimensions, color, font, glyphs), bus(bus_), field(field_)
+    {
+        this->subscription = 0;
+    }
 
-    void handle_event(const SDL_Event *event);
+    ~FieldBox()
+    {
+        this->bus->unsubscribe(this->subscription);
+    }
+
+    // shows field at the mouse, the text follows the changes of the field until another one is shown
+    void show(FieldMeta *field);
 
     virtual void update();
 
     void update_position(SDL_Point point);
 
 protected:
+    EventBus *bus;
     FieldMeta *field;
+    EventBus::Subscription subscription; // to the changes of field
 };
 
 class UpgradeBox;
@@ -129,9 +232,9 @@ class UpgradeBox;
 class UpgradeButtonBox : public TextBox
 {
 public:
-    UpgradeButtonBox(Renderer *renderer, SDL_Rect dimensions, SDL_Color color, TTF_Font *font, UpgradeBox *box_,
-                     Upgrade upgrade)
-            : TextBox(renderer, dimensions, color, font), box(box_), upgrade(upgrade) { }
+    UpgradeButtonBox(Renderer *renderer, SDL_Rect dimensions, SDL_Color color, TTF_Font *font, GlyphAtlas *glyphs,
+                     UpgradeBox *box_, Upgrade upgrade)
+            : TextBox(renderer, dimensions, color, font, glyphs), box(box_), upgrade(upgrade) { }
 
     Upgrade get_upgrade() { return this->upgrade; }
 
@@ -148,22 +251,27 @@ private:
 class UpgradeBox : public Box
 {
 public:
-    UpgradeBox(Renderer *renderer, SDL_Rect dimensions, SDL_Color color, TTF_Font *font, FieldMeta *field_)
-            : Box(renderer, dimensions, color), field(field_)
+    UpgradeBox(Renderer *renderer, SDL_Rect dimensions, SDL_Color color, TTF_Font *font, GlyphAtlas *glyphs,
+               EventBus *bus_, FieldMeta *field_)
+            : Box(renderer, dimensions, color), bus(bus_), field(field_)
     {
+        this->changed_subscription = 0;
+        this->upgraded_subscription = 0;
         for (Upgrade upgrade : UPGRADES)
         {
             UpgradeButtonBox *box = new UpgradeButtonBox(renderer, {0, dimensions.y, dimensions.w, 20}, color, font,
-                                                         this, upgrade);
+                                                         glyphs, this, upgrade);
             box->load_text(UPGRADE_NAMES.at(upgrade));
             this->marked_upgrade = box;
             this->upgrades.push_back(box);
         }
-        this->upgrade_info = new TextBox(renderer, {0, 0, dimensions.w, 200}, color, font);
+        this->upgrade_info = new TextBox(renderer, {0, 0, dimensions.w, 200}, color, font, glyphs);
     }
 
     ~UpgradeBox()
     {
+        this->bus->unsubscribe(this->changed_subscription);
+        this->bus->unsubscribe(this->upgraded_subscription);
         for (auto box : upgrades)
         {
             delete box;
@@ -173,6 +281,8 @@ public:
 
     void handle_event(const SDL_Event *event);
 
+    void prepare(Damage *damage);
+
     void render(Renderer *renderer);
 
     FieldMeta *get_field() { return this->field; }
@@ -183,11 +293,18 @@ public:
 
     void update_upgrade_boxes();
 
+    // opens the box for field at the mouse, unless it is open already
+    void select(FieldMeta *field);
+
 private:
     std::vector<UpgradeButtonBox *> upgrades;
     UpgradeButtonBox *marked_upgrade;
     TextBox *upgrade_info;
+    EventBus *bus;
     FieldMeta *field;
+    // to the changes of field
+    EventBus::Subscription changed_subscription;
+    EventBus::Subscription upgraded_subscription;
 };
 
 class Container
@@ -201,6 +318,8 @@ public:
 
     void add(Box *box) { this->elements.push_back(box); }
 
+    void prepare(Damage *damage);
+
     void render(Renderer *renderer);
 
     void set_visible(bool visible);
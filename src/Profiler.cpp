@@ -0,0 +1,84 @@
+#include "Profiler.hpp"
+#include <algorithm>
+
+Profiler *Profiler::profiler = nullptr;
+
+void Profiler::add(const char *section, Uint64 counts)
+{
+    for (Section &known : this->sections)
+    {
+        if (known.name == section)
+        {
+            known.current += counts;
+            return;
+        }
+    }
+    // frames before the section was first entered count with zero
+    this->sections.push_back({section, std::vector<double>(Profiler::HISTORY, 0.0), counts});
+}
+
+void Profiler::end_frame()
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+    this->add("frame", now - this->frame_started);
+    this->frame_started = now;
+    size_t slot = this->frames % Profiler::HISTORY;
+    for (Section &section : this->sections)
+    {
+        section.history[slot] = 1000.0 * section.current / this->frequency;
+        section.current = 0;
+    }
+    this->frames++;
+}
+
+static double percentile(std::vector<double> &values, double p)
+{
+    size_t nth = std::min(values.size() - 1, (size_t) (p * values.size()));
+    std::nth_element(values.begin(), values.begin() + nth, values.end());
+    return values[nth];
+}
+
+std::vector<Profiler::Summary> Profiler::summarize()
+{
+    std::vector<Summary> summaries;
+    size_t count = std::min(this->frames, (Uint64) Profiler::HISTORY);
+    if (count == 0)
+        return summaries;
+    for (Section &section : this->sections)
+    {
+        std::vector<double> values(section.history.begin(), section.history.begin() + count);
+        Summary summary;
+        summary.section = section.name;
+        summary.p50 = percentile(values, 0.50);
+        summary.p95 = percentile(values, 0.95);
+        summary.p99 = percentile(values, 0.99);
+        summary.max = *std::max_element(values.begin(), values.end());
+        summaries.push_back(summary);
+    }
+    return summaries;
+}
+
+void Profiler::dump(std::ostream &out)
+{
+    out << "section,p50,p95,p99,max" << std::endl;
+    for (Summary &summary : this->summarize())
+    {
+        out << summary.section << "," << summary.p50 << "," << summary.p95 << "," << summary.p99 << ","
+        << summary.max << std::endl;
+    }
+}
+
+bool Profiler::init()
+{
+    profiler = new Profiler();
+    return profiler != nullptr;
+}
+
+bool Profiler::destroy()
+{
+    if (profiler == nullptr)
+        return false;
+    delete profiler;
+    profiler = nullptr;
+    return true;
+}
@@ -0,0 +1,85 @@
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include <SDL2/SDL.h>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Trace.hpp"
+
+// time spent in named sections per frame, kept for the last HISTORY frames
+class Profiler
+{
+public:
+    struct Summary
+    {
+        std::string section;
+        double p50; // milliseconds per frame
+        double p95;
+        double p99;
+        double max;
+    };
+
+    Profiler()
+    {
+        this->frequency = SDL_GetPerformanceFrequency();
+        this->frame_started = SDL_GetPerformanceCounter();
+        this->frames = 0;
+    }
+
+    // adds to the time of section in the current frame
+    void add(const char *section, Uint64 counts);
+
+    // closes the current frame, sections that weren't entered count with zero,
+    // the section "frame" is the time since the last frame, waiting included
+    void end_frame();
+
+    std::vector<Summary> summarize();
+
+    // one line per section as CSV, in milliseconds
+    void dump(std::ostream &out);
+
+    static const size_t HISTORY = 600;
+    static Profiler *profiler;
+
+    static bool init();
+
+    static bool destroy();
+
+private:
+    struct Section
+    {
+        std::string name;
+        std::vector<double> history; // ring buffer of the last frames
+        Uint64 current; // counts in the current frame
+    };
+
+    std::vector<Section> sections; // a handful, searched linearly
+    Uint64 frequency;
+    Uint64 frame_started;
+    Uint64 frames; // closed so far, the next one is stored at frames % HISTORY
+};
+
+// adds its lifetime to section, does nothing without a profiler, a span of the trace as well
+class ScopedTimer
+{
+public:
+    ScopedTimer(const char *section_)
+            : section(section_), span(section_, "frame")
+    {
+        this->started = SDL_GetPerformanceCounter();
+    }
+
+    ~ScopedTimer()
+    {
+        if (Profiler::profiler != nullptr)
+            Profiler::profiler->add(this->section, SDL_GetPerformanceCounter() - this->started);
+    }
+
+private:
+    const char *section;
+    TraceSpan span;
+    Uint64 started;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef _BOB_RANDOM_H
+#define _BOB_RANDOM_H
+
+#include <cstdint>
+#include <limits>
+
+// PCG32 (XSH RR), small and fast, every stream is an independent sequence for the same seed
+class Pcg32
+{
+public:
+    typedef uint32_t result_type;
+
+    Pcg32(uint64_t seed_ = 0, uint64_t stream_ = 0)
+    {
+        this->seed(seed_, stream_);
+    }
+
+    void seed(uint64_t seed_, uint64_t stream_ = 0)
+    {
+        this->state = 0;
+        this->increment = (stream_ << 1) | 1;
+        this->step();
+        this->state += seed_;
+        this->step();
+    }
+
+    uint32_t operator()()
+    {
+        uint64_t old = this->state;
+        this->step();
+        uint32_t xorshifted = (uint32_t) (((old >> 18) ^ old) >> 27);
+        uint32_t rotation = (uint32_t) (old >> 59);
+        return (xorshifted >> rotation) | (xorshifted << ((32 - rotation) & 31));
+    }
+
+    // uniform in [0, bound), the same on every platform unlike the std distributions
+    uint32_t bounded(uint32_t bound)
+    {
+        uint32_t threshold = (0u - bound) % bound;
+        while (true)
+        {
+            uint32_t r = (*this)();
+            if (r >= threshold)
+                return r % bound;
+        }
+    }
+
+    // uniform in [0, 1)
+    double uniform()
+    {
+        return (*this)() * (1.0 / 4294967296.0);
+    }
+
+    static constexpr uint32_t min() { return 0; }
+
+    static constexpr uint32_t max() { return std::numeric_limits<uint32_t>::max(); }
+
+private:
+    uint64_t state;
+    uint64_t increment;
+
+    void step()
+    {
+        this->state = this->state * 6364136223846793005ULL + this->increment;
+    }
+};
+
+#endif
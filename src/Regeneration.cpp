@@ -0,0 +1,98 @@
+#include "Regeneration.hpp"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define BOB_REGENERATION_X86
+#include <immintrin.h>
+#endif
+
+typedef void (*RegenerationKernel)(size_t begin, size_t end, const uint16_t *upgrades, const uint8_t *const base[3],
+                                   uint16_t *const resources[3]);
+
+static void regenerate_scalar(size_t begin, size_t end, const uint16_t *upgrades, const uint8_t *const base[3],
+                              uint16_t *const resources[3])
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        uint32_t shift = regeneration_shift(upgrades[i]);
+        resources[0][i] = (uint16_t) (base[0][i] << shift);
+        resources[1][i] = (uint16_t) (base[1][i] << shift);
+        resources[2][i] = (uint16_t) (base[2][i] << shift);
+    }
+}
+
+#ifdef BOB_REGENERATION_X86
+// there are no shifts by lane for 16 bit lanes, so every upgrade shifts the lanes that have it,
+// sse2 is part of x86-64 and does 8 fields at once
+static void regenerate_sse2(size_t begin, size_t end, const uint16_t *upgrades, const uint8_t *const base[3],
+                            uint16_t *const resources[3])
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bit_1 = _mm_set1_epi16(1);
+    const __m128i bit_2 = _mm_set1_epi16(2);
+    const __m128i bit_3 = _mm_set1_epi16(4);
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m128i flags = _mm_loadu_si128((const __m128i *) (upgrades + i));
+        __m128i has_1 = _mm_cmpeq_epi16(_mm_and_si128(flags, bit_1), bit_1);
+        __m128i has_2 = _mm_cmpeq_epi16(_mm_and_si128(flags, bit_2), bit_2);
+        __m128i has_3 = _mm_cmpeq_epi16(_mm_and_si128(flags, bit_3), bit_3);
+        for (int kind = 0; kind < 3; kind++)
+        {
+            __m128i value = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (base[kind] + i)), zero);
+            value = _mm_or_si128(_mm_and_si128(has_1, _mm_slli_epi16(value, 1)), _mm_andnot_si128(has_1, value));
+            value = _mm_or_si128(_mm_and_si128(has_2, _mm_slli_epi16(value, 2)), _mm_andnot_si128(has_2, value));
+            value = _mm_or_si128(_mm_and_si128(has_3, _mm_slli_epi16(value, 3)), _mm_andnot_si128(has_3, value));
+            _mm_storeu_si128((__m128i *) (resources[kind] + i), value);
+        }
+    }
+    regenerate_scalar(i, end, upgrades, base, resources);
+}
+
+// the same with 16 fields at once
+__attribute__((target("avx2")))
+static void regenerate_avx2(size_t begin, size_t end, const uint16_t *upgrades, const uint8_t *const base[3],
+                            uint16_t *const resources[3])
+{
+    const __m256i bit_1 = _mm256_set1_epi16(1);
+    const __m256i bit_2 = _mm256_set1_epi16(2);
+    const __m256i bit_3 = _mm256_set1_epi16(4);
+    size_t i = begin;
+    for (; i + 16 <= end; i += 16)
+    {
+        __m256i flags = _mm256_loadu_si256((const __m256i *) (upgrades + i));
+        __m256i has_1 = _mm256_cmpeq_epi16(_mm256_and_si256(flags, bit_1), bit_1);
+        __m256i has_2 = _mm256_cmpeq_epi16(_mm256_and_si256(flags, bit_2), bit_2);
+        __m256i has_3 = _mm256_cmpeq_epi16(_mm256_and_si256(flags, bit_3), bit_3);
+        for (int kind = 0; kind < 3; kind++)
+        {
+            __m256i value = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (base[kind] + i)));
+            value = _mm256_blendv_epi8(value, _mm256_slli_epi16(value, 1), has_1);
+            value = _mm256_blendv_epi8(value, _mm256_slli_epi16(value, 2), has_2);
+            value = _mm256_blendv_epi8(value, _mm256_slli_epi16(value, 3), has_3);
+            _mm256_storeu_si256((__m256i *) (resources[kind] + i), value);
+        }
+    }
+    regenerate_scalar(i, end, upgrades, base, resources);
+}
+#endif
+
+static RegenerationKernel select_kernel()
+{
+#ifdef BOB_REGENERATION_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return regenerate_avx2;
+    return regenerate_sse2;
+#else
+    return regenerate_scalar;
+#endif
+}
+
+void regenerate_resources(size_t count, const uint16_t *upgrades, const uint8_t *const base[3],
+                          uint16_t *const resources[3])
+{
+    // decided once, on first use
+    static const RegenerationKernel kernel = select_kernel();
+    kernel(0, count, upgrades, base, resources);
+}
@@ -0,0 +1,18 @@
+#ifndef _REGENERATION_H
+#define _REGENERATION_H
+
+#include <cstddef>
+#include <cstdint>
+
+// the regeneration upgrades are the lowest three bits of an upgrade mask and multiply by 2, 4 and 8
+inline uint32_t regeneration_shift(uint16_t upgrades)
+{
+    return (upgrades & 1) + 2 * ((upgrades >> 1) & 1) + 3 * ((upgrades >> 2) & 1);
+}
+
+// resources[kind][i] = base[kind][i] << regeneration_shift(upgrades[i]) for the three kinds of resources,
+// uses AVX2 or SSE2 if the processor has them, plain C++ otherwise
+void regenerate_resources(size_t count, const uint16_t *upgrades, const uint8_t *const base[3],
+                          uint16_t *const resources[3]);
+
+#endif
@@ -0,0 +1,293 @@
+#include <atomic>
+#include <fstream>
+#include <thread>
+#include "Bots.hpp"
+
+struct SelfplayOptions
+{
+    uint32_t games;
+    int16_t radius;
+    uint32_t players;
+    uint64_t seed;
+    uint32_t threads;
+    uint32_t sweep_threads; // threads per game for the reproduction sweep
+    uint32_t max_turns;
+    std::string output;
+    std::string timeline;
+    std::string trace; // Chrome trace of the whole run, none if empty
+    std::string bot; // computer player for every player, none if empty
+    uint32_t budget; // milliseconds per bot turn
+};
+
+struct GameResult
+{
+    uint32_t turns;
+    uint32_t winner; // 1-based number of the winning player, 0 if undecided
+    std::vector<uint32_t> numbers; // 1-based number of every player that could be placed
+    std::vector<uint32_t> cells; // per placed player at the end of the game
+    std::vector<std::vector<uint32_t>> timeline; // cells per player at the start of every round
+};
+
+std::vector<uint32_t> count_cells(Simulation &sim, std::vector<Player> &players)
+{
+    std::vector<uint32_t> cells;
+    for (Player &player : players)
+    {
+        cells.push_back(sim.get_grid()->count_fields(player));
+    }
+    return cells;
+}
+
+GameResult play_game(uint32_t game, const SelfplayOptions &options)
+{
+    GameResult result;
+    // one stream per game, so the results don't depend on which thread played it
+    Simulation sim(options.radius, options.seed, game);
+    std::vector<Player> players;
+    std::vector<uint32_t> numbers;
+    sim.get_grid()->set_threads(options.sweep_threads);
+    Pcg32 &rng = sim.get_grid()->get_rng();
+    uint32_t span = 2 * (uint32_t) options.radius - 1;
+    for (uint32_t i = 0; i < options.players; i++)
+    {
+        std::ostringstream name;
+        name << "Player " << i + 1;
+        Player player(name.str());
+        // look for a free spot with resources, give up on crowded maps
+        for (int attempt = 0; attempt < 1000; attempt++)
+        {
+            int16_t x = (int16_t) ((int32_t) rng.bounded(span) - options.radius + 1);
+            int16_t y = (int16_t) ((int32_t) rng.bounded(span) - options.radius + 1);
+            if (std::abs(x + y) >= options.radius)
+                continue;
+            if (sim.add_player(player, Field(x, y, (int16_t) (-x - y))))
+            {
+                players.push_back(player);
+                numbers.push_back(i + 1);
+                break;
+            }
+        }
+    }
+    result.turns = 0;
+    result.winner = 0;
+    result.numbers = numbers;
+    if (players.empty())
+        return result;
+    std::vector<Bot *> bots;
+    for (uint32_t i = 0; i < players.size() && !options.bot.empty(); i++)
+    {
+        bots.push_back(create_bot(options.bot, options.budget, options.seed, (uint64_t) game * options.players + i));
+    }
+    for (Bot *bot : bots)
+    {
+        bot->prepare(GridView(sim.get_grid()));
+    }
+    sim.start();
+    std::vector<uint32_t> cells = count_cells(sim, players);
+    while (true)
+    {
+        if (sim.get_turn() % players.size() == 0)
+        {
+            cells = count_cells(sim, players);
+            result.timeline.push_back(cells);
+            long alive = std::count_if(cells.begin(), cells.end(), [](uint32_t c) { return c > 0; });
+            if (alive <= 1)
+                break;
+        }
+        // the limit may end a game within a round
+        if (sim.get_turn() >= options.max_turns)
+        {
+            cells = count_cells(sim, players);
+            break;
+        }
+        if (!bots.empty())
+        {
+            Player &current = sim.get_current();
+            uint32_t index = (uint32_t) (std::find(players.begin(), players.end(), current) - players.begin());
+            GridView view(sim.get_grid());
+            Deadline now = std::chrono::steady_clock::now();
+            Deadline turn_deadline = now + std::chrono::milliseconds(bots[index]->get_budget());
+            for (uint32_t moves = 0; moves < Bot::MAX_MOVES_PER_TURN && now < turn_deadline; moves++)
+            {
+                // every decision may use half of the remaining time, so the turn always ends in time
+                BotMove move = bots[index]->decide(view, current, now + (turn_deadline - now) / 2);
+                if (move.type == BotMove::EndTurn)
+                    break;
+                apply_move(sim.get_grid(), current, move);
+                now = std::chrono::steady_clock::now();
+            }
+        }
+        sim.next_turn();
+    }
+    for (Bot *bot : bots)
+    {
+        delete bot;
+    }
+    result.turns = sim.get_turn();
+    result.cells = cells;
+    // the player holding the most cells wins, a tie is undecided
+    result.winner = 0;
+    uint32_t best = 0;
+    for (uint32_t i = 0; i < cells.size(); i++)
+    {
+        if (cells[i] > best)
+        {
+            best = cells[i];
+            result.winner = numbers[i];
+        }
+        else if (cells[i] == best)
+        {
+            result.winner = 0;
+        }
+    }
+    return result;
+}
+
+void write_results(const SelfplayOptions &options, std::vector<GameResult> &results)
+{
+    std::ofstream output(options.output);
+    output << "game,turns,winner";
+    for (uint32_t i = 0; i < options.players; i++)
+    {
+        output << ",cells_" << i + 1;
+    }
+    output << "\n";
+    for (uint32_t game = 0; game < results.size(); game++)
+    {
+        output << game << "," << results[game].turns << "," << results[game].winner;
+        // players that couldn't be placed keep their column, empty
+        const std::vector<uint32_t> &numbers = results[game].numbers;
+        for (uint32_t number = 1; number <= options.players; number++)
+        {
+            output << ",";
+            auto placed = std::find(numbers.begin(), numbers.end(), number);
+            if (placed != numbers.end())
+                output << results[game].cells[placed - numbers.begin()];
+        }
+        output << "\n";
+    }
+    if (options.timeline.empty())
+        return;
+    std::ofstream timeline(options.timeline);
+    timeline << "game,round,player,cells\n";
+    for (uint32_t game = 0; game < results.size(); game++)
+    {
+        for (uint32_t round = 0; round < results[game].timeline.size(); round++)
+        {
+            for (uint32_t i = 0; i < results[game].timeline[round].size(); i++)
+            {
+                timeline << game << "," << round << "," << results[game].numbers[i] << ","
+                << results[game].timeline[round][i] << "\n";
+            }
+        }
+    }
+}
+
+void print_usage(const char *name)
+{
+    std::cerr << "Usage: " << name << " [--games N] [--radius N] [--players N] [--seed N] [--threads N] [--sweep-threads N]"
+    << " [--max-turns N] [--output FILE] [--timeline FILE] [--trace FILE] [--bot greedy|montecarlo] [--budget MS]"
+    << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    SelfplayOptions options;
+    options.games = 100;
+    options.radius = 10;
+    options.players = 2;
+    options.seed = 0;
+    options.threads = std::max(1u, std::thread::hardware_concurrency());
+    options.sweep_threads = 1;
+    options.max_turns = 1000;
+    options.output = "selfplay.csv";
+    options.budget = 50;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--games")
+            options.games = (uint32_t) std::stoul(value);
+        else if (arg == "--radius")
+            options.radius = (int16_t) std::stoi(value);
+        else if (arg == "--players")
+            options.players = (uint32_t) std::stoul(value);
+        else if (arg == "--seed")
+            options.seed = std::stoull(value);
+        else if (arg == "--threads")
+            options.threads = std::max(1ul, std::stoul(value));
+        else if (arg == "--sweep-threads")
+            options.sweep_threads = (uint32_t) std::max(1ul, std::stoul(value));
+        else if (arg == "--max-turns")
+            options.max_turns = (uint32_t) std::stoul(value);
+        else if (arg == "--output")
+            options.output = value;
+        else if (arg == "--timeline")
+            options.timeline = value;
+        else if (arg == "--trace")
+            options.trace = value;
+        else if (arg == "--bot")
+            options.bot = value;
+        else if (arg == "--budget")
+            options.budget = (uint32_t) std::stoul(value);
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.players < 1 || options.radius < 2)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (!options.bot.empty())
+    {
+        Bot *bot = create_bot(options.bot, options.budget);
+        if (bot == nullptr)
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+        delete bot;
+    }
+    if (!options.trace.empty())
+    {
+        Trace::start();
+    }
+    // every worker takes the next game that has not been played yet
+    std::vector<GameResult> results(options.games);
+    std::atomic<uint32_t> next_game(0);
+    std::vector<std::thread> workers;
+    for (uint32_t t = 0; t < options.threads; t++)
+    {
+        workers.push_back(std::thread([&]()
+                                      {
+                                          uint32_t game;
+                                          while ((game = next_game++) < options.games)
+                                          {
+                                              results[game] = play_game(game, options);
+                                          }
+                                      }));
+    }
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    write_results(options, results);
+    if (!options.trace.empty())
+    {
+        Trace::stop();
+        if (!Trace::write(options.trace))
+        {
+            std::cerr << "Failed to write the trace to " << options.trace << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,956 @@
+#include <atomic>
+#include <thread>
+#include "Simulation.hpp"
+
+PlayerManager *PlayerManager::pm = nullptr;
+
+uint64_t Grid::next_serial = 1;
+const uint32_t Grid::REGENERATION;
+
+Field Field::cubic_round(double x, double y, double z)
+{
+    double round_x = std::round(x);
+    double round_y = std::round(y);
+    double round_z = std::round(z);
+    double x_err = std::abs(round_x - x);
+    double y_err = std::abs(round_y - y);
+    double z_err = std::abs(round_z - z);
+    if (x_err > y_err && x_err > z_err)
+    {
+        round_x = -round_y - round_z;
+    } else if (y_err > z_err)
+    {
+        round_y = -round_x - round_z;
+    } else
+    {
+        round_z = -round_x - round_y;
+    }
+    int16_t x_out = (int) round_x;
+    int16_t y_out = (int) round_y;
+    int16_t z_out = (int) round_z;
+    return Field(x_out, y_out, z_out);
+}
+
+Field Field::hex_direction(uint8_t direction)
+{
+    assert (0 <= direction && direction <= 5);
+    return hex_directions[direction];
+}
+
+Field Field::get_neighbor(uint8_t direction) const
+{
+    return hex_direction(direction) + *this;
+}
+
+Resource Grid::get_resources_of_cluster(Cluster *cluster)
+{
+    this->refresh_sum(cluster);
+    return cluster->resources;
+}
+
+void Grid::refresh_sum(Cluster *cluster)
+{
+    if (this->is_summed(cluster))
+        return;
+    cluster->resources = {0, 0, 0};
+    for (uint32_t member : cluster->members)
+    {
+        cluster->resources += this->cells.resources.get(member);
+    }
+    cluster->regeneration = this->regenerations;
+}
+
+bool FieldMeta::upgrade(Upgrade upgrade)
+{
+    TraceSpan span("FieldMeta::upgrade");
+    // check available resources for cluster and consume resources
+    uint16_t &upgrades = this->grid->cells.upgrades[this->index];
+    if (upgrades & (1 << upgrade))
+        return true;
+    this->grid->record(this->index);
+    Cluster *cluster = this->grid->get_cluster(this);
+    Resource cluster_resources = this->grid->get_resources_of_cluster(cluster);
+    auto pair = UPGRADE_COSTS.find(upgrade);
+    if (pair != UPGRADE_COSTS.end())
+    {
+        Resource costs = pair->second;
+        if (costs > cluster_resources) // too expensive for you
+            return false;
+        Resource remaining_costs = this->grid->consume_resources_of_cluster(cluster, costs);
+        static const Resource neutral = {0, 0, 0};
+        if (remaining_costs == neutral)
+        {
+            upgrades |= 1 << upgrade;
+        }
+    }
+    this->grid->field_upgraded(this);
+    return (upgrades & (1 << upgrade)) != 0;
+}
+
+FieldMeta *FieldMeta::get_neighbor(uint8_t direction)
+{
+    return this->grid->get_neighbor(this, direction);
+}
+
+FieldMeta *Grid::get_neighbor(FieldMeta *meta, uint8_t direction)
+{
+    int32_t neighbor = this->neighbors[6 * this->get_index(meta) + direction];
+    if (neighbor < 0)
+        return nullptr;
+    return &(this->fields[neighbor]);
+}
+
+int32_t Grid::field_index(Field field)
+{
+    if (field.x < -this->radius || field.x > this->radius)
+        return -1;
+    int16_t y_l = (-this->radius > -field.x - this->radius) ? -this->radius : -field.x - this->radius;
+    int16_t y_u = (this->radius < -field.x + this->radius) ? this->radius : -field.x + this->radius;
+    if (field.y < y_l || field.y > y_u)
+        return -1;
+    return this->row_offsets[field.x + this->radius] + (field.y - y_l);
+}
+
+Cluster *Grid::get_cluster(FieldMeta *field)
+{
+    TraceSpan span("Grid::get_cluster");
+    // only valid until the next change of ownership
+    return &(this->clusters[this->cluster_of[this->get_index(field)]]);
+}
+
+uint32_t Grid::new_cluster()
+{
+    if (!this->free_clusters.empty())
+    {
+        uint32_t cluster = this->free_clusters.back();
+        this->free_clusters.pop_back();
+        this->clusters[cluster].resources = {0, 0, 0};
+        this->clusters[cluster].regeneration = this->regenerations;
+        return cluster;
+    }
+    this->clusters.push_back(Cluster());
+    this->clusters.back().resources = {0, 0, 0};
+    this->clusters.back().regeneration = this->regenerations;
+    return (uint32_t) (this->clusters.size() - 1);
+}
+
+void Grid::add_member(uint32_t cluster, uint32_t index)
+{
+    std::vector<uint32_t> &members = this->clusters[cluster].members;
+    this->cluster_of[index] = cluster;
+    this->member_positions[index] = (uint32_t) members.size();
+    members.push_back(index);
+    if (this->is_summed(&(this->clusters[cluster])))
+        this->clusters[cluster].resources += this->cells.resources.get(index);
+}
+
+void Grid::remove_member(uint32_t index)
+{
+    uint32_t cluster = this->cluster_of[index];
+    std::vector<uint32_t> &members = this->clusters[cluster].members;
+    uint32_t position = this->member_positions[index];
+    uint32_t last = members.back();
+    members[position] = last;
+    this->member_positions[last] = position;
+    members.pop_back();
+    if (this->is_summed(&(this->clusters[cluster])))
+        this->clusters[cluster].resources -= this->cells.resources.get(index);
+    this->cluster_of[index] = (uint32_t) -1;
+    if (members.empty())
+    {
+        this->free_clusters.push_back(cluster);
+    }
+}
+
+void Grid::build_clusters()
+{
+    this->clusters.clear();
+    this->free_clusters.clear();
+    this->visit_generation++;
+    std::vector<uint32_t> stack;
+    for (uint32_t start = 0; start < this->fields.size(); start++)
+    {
+        if (this->visit_marks[start] == this->visit_generation)
+            continue;
+        uint32_t cluster = this->new_cluster();
+        this->visit_marks[start] = this->visit_generation;
+        stack.push_back(start);
+        while (!stack.empty())
+        {
+            uint32_t current = stack.back();
+            stack.pop_back();
+            this->add_member(cluster, current);
+            for (uint8_t i = 0; i < 6; i++)
+            {
+                int32_t neighbor = this->neighbors[6 * current + i];
+                if (neighbor >= 0 && this->visit_marks[neighbor] != this->visit_generation
+                    && this->cells.owners[neighbor] == this->cells.owners[current])
+                {
+                    this->visit_marks[neighbor] = this->visit_generation;
+                    stack.push_back((uint32_t) neighbor);
+                }
+            }
+        }
+    }
+}
+
+void Grid::attach_to_cluster(FieldMeta *meta)
+{
+    uint32_t index = this->get_index(meta);
+    // join the largest neighboring cluster of the same owner and merge the smaller ones into it
+    uint32_t target = 0;
+    bool found = false;
+    uint32_t adjacent[6];
+    uint8_t num_adjacent = 0;
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        int32_t neighbor = this->neighbors[6 * index + i];
+        if (neighbor < 0 || this->cells.owners[neighbor] != this->cells.owners[index])
+            continue;
+        uint32_t cluster = this->cluster_of[neighbor];
+        if (std::find(adjacent, adjacent + num_adjacent, cluster) != adjacent + num_adjacent)
+            continue;
+        adjacent[num_adjacent++] = cluster;
+        if (!found || this->clusters[cluster].members.size() > this->clusters[target].members.size())
+        {
+            target = cluster;
+            found = true;
+        }
+    }
+    if (!found)
+    {
+        target = this->new_cluster();
+    }
+    this->add_member(target, index);
+    for (uint8_t i = 0; i < num_adjacent; i++)
+    {
+        uint32_t cluster = adjacent[i];
+        if (cluster == target)
+            continue;
+        for (uint32_t member : this->clusters[cluster].members)
+        {
+            this->add_member(target, member);
+        }
+        this->clusters[cluster].members.clear();
+        this->free_clusters.push_back(cluster);
+    }
+}
+
+void Grid::detach_from_cluster(FieldMeta *meta)
+{
+    uint32_t index = this->get_index(meta);
+    uint32_t cluster = this->cluster_of[index];
+    this->remove_member(index);
+    if (this->clusters[cluster].members.empty())
+        return;
+    // walk around the field, the remaining neighbors of the owner form arcs on this ring
+    // fields inside an arc are adjacent to each other, so only separate arcs may have been disconnected
+    bool same[6];
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        int32_t neighbor = this->neighbors[6 * index + i];
+        same[i] = neighbor >= 0 && this->cells.owners[neighbor] == this->cells.owners[index];
+    }
+    std::vector<uint32_t> seeds;
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        if (same[i] && !same[(i + 5) % 6])
+            seeds.push_back((uint32_t) this->neighbors[6 * index + i]);
+    }
+    if (seeds.size() > 1)
+    {
+        this->split_cluster(cluster, seeds);
+    }
+}
+
+void Grid::split_cluster(uint32_t cluster, const std::vector<uint32_t> &seeds)
+{
+    // explore from all seeds in lockstep, searches meeting each other belong to the same part
+    // a finished part is moved into a new cluster as long as another part is left behind,
+    // so a split costs about the size of the smaller parts instead of the whole cluster
+    uint8_t num_searches = (uint8_t) seeds.size();
+    std::vector<std::vector<uint32_t>> reached(num_searches);
+    std::vector<size_t> heads(num_searches, 0);
+    std::vector<uint8_t> group(num_searches);
+    std::vector<bool> moved(num_searches, false);
+    this->visit_generation++;
+    for (uint8_t s = 0; s < num_searches; s++)
+    {
+        group[s] = s;
+        this->visit_marks[seeds[s]] = this->visit_generation;
+        this->visit_searches[seeds[s]] = s;
+        reached[s].push_back(seeds[s]);
+    }
+    while (true)
+    {
+        uint8_t parts = 0;
+        for (uint8_t s = 0; s < num_searches; s++)
+        {
+            if (group[s] == s && !moved[s])
+                parts++;
+        }
+        for (uint8_t s = 0; s < num_searches && parts > 1; s++)
+        {
+            if (group[s] != s || moved[s])
+                continue;
+            bool finished = true;
+            for (uint8_t t = 0; t < num_searches; t++)
+            {
+                if (group[t] == s && heads[t] < reached[t].size())
+                    finished = false;
+            }
+            if (!finished)
+                continue;
+            uint32_t split = this->new_cluster();
+            for (uint8_t t = 0; t < num_searches; t++)
+            {
+                if (group[t] != s)
+                    continue;
+                for (uint32_t member : reached[t])
+                {
+                    this->remove_member(member);
+                    this->add_member(split, member);
+                }
+            }
+            moved[s] = true;
+            parts--;
+        }
+        if (parts <= 1) // the remaining part keeps the cluster
+            break;
+        for (uint8_t s = 0; s < num_searches; s++)
+        {
+            if (heads[s] >= reached[s].size())
+                continue;
+            uint32_t current = reached[s][heads[s]++];
+            for (uint8_t i = 0; i < 6; i++)
+            {
+                int32_t neighbor = this->neighbors[6 * current + i];
+                if (neighbor < 0 || this->cluster_of[neighbor] != cluster)
+                    continue;
+                if (this->visit_marks[neighbor] != this->visit_generation)
+                {
+                    this->visit_marks[neighbor] = this->visit_generation;
+                    this->visit_searches[neighbor] = s;
+                    reached[s].push_back((uint32_t) neighbor);
+                    continue;
+                }
+                // met another search, both are exploring the same part
+                uint8_t a = group[s];
+                uint8_t b = group[this->visit_searches[neighbor]];
+                if (a == b)
+                    continue;
+                for (uint8_t t = 0; t < num_searches; t++)
+                {
+                    if (group[t] == b)
+                        group[t] = a;
+                }
+            }
+        }
+    }
+}
+
+bool Grid::is_frontier(uint32_t index)
+{
+    PlayerId owner = this->cells.owners[index];
+    if (owner == 0)
+        return false;
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        int32_t neighbor = this->neighbors[6 * index + i];
+        if (neighbor >= 0 && this->cells.owners[neighbor] != owner)
+            return true;
+    }
+    return false;
+}
+
+void Grid::add_to_frontier(uint32_t index)
+{
+    PlayerId owner = this->cells.owners[index];
+    if (owner >= this->frontiers.size())
+        this->frontiers.resize(owner + 1);
+    std::vector<uint32_t> &frontier = this->frontiers[owner];
+    this->frontier_positions[index] = (uint32_t) frontier.size();
+    frontier.push_back(index);
+}
+
+void Grid::remove_from_frontier(uint32_t index)
+{
+    std::vector<uint32_t> &frontier = this->frontiers[this->cells.owners[index]];
+    uint32_t position = this->frontier_positions[index];
+    uint32_t last = frontier.back();
+    frontier[position] = last;
+    this->frontier_positions[last] = position;
+    frontier.pop_back();
+    this->frontier_positions[index] = (uint32_t) -1;
+}
+
+void Grid::build_frontiers()
+{
+    this->frontiers.clear();
+    this->frontier_positions.assign(this->fields.size(), (uint32_t) -1);
+    for (uint32_t index = 0; index < this->fields.size(); index++)
+    {
+        if (this->is_frontier(index))
+            this->add_to_frontier(index);
+    }
+}
+
+const std::vector<uint32_t> &Grid::get_frontier(Player &player)
+{
+    return this->get_frontier(this->players->find(player));
+}
+
+const std::vector<uint32_t> &Grid::get_frontier(PlayerId owner)
+{
+    static const std::vector<uint32_t> empty;
+    if (owner == NO_PLAYER || owner >= this->frontiers.size())
+        return empty;
+    return this->frontiers[owner];
+}
+
+void Grid::leave_frontier(FieldMeta *meta)
+{
+    uint32_t index = this->get_index(meta);
+    if (this->frontier_positions[index] != (uint32_t) -1)
+        this->remove_from_frontier(index);
+}
+
+void Grid::update_frontier(FieldMeta *meta)
+{
+    // only the field itself and its direct neighbors can enter or leave a frontier
+    uint32_t index = this->get_index(meta);
+    for (uint8_t i = 0; i <= 6; i++)
+    {
+        int32_t current = (i == 6) ? (int32_t) index : this->neighbors[6 * index + i];
+        if (current < 0)
+            continue;
+        bool member = this->frontier_positions[current] != (uint32_t) -1;
+        bool frontier = this->is_frontier((uint32_t) current);
+        if (frontier && !member)
+            this->add_to_frontier((uint32_t) current);
+        else if (!frontier && member)
+            this->remove_from_frontier((uint32_t) current);
+    }
+}
+
+PlayerId PlayerRegistry::find(const Player &player)
+{
+    // the id of an earlier add is checked first, a handful of players is searched linearly otherwise
+    if (player.id < this->players.size() && this->players[player.id] == player)
+        return player.id;
+    for (PlayerId id = 0; id < this->players.size(); id++)
+    {
+        if (this->players[id] == player)
+            return id;
+    }
+    return NO_PLAYER;
+}
+
+PlayerId PlayerRegistry::add(Player &player)
+{
+    PlayerId id = this->find(player);
+    if (id == NO_PLAYER)
+    {
+        assert(this->players.size() < NO_PLAYER);
+        id = (PlayerId) this->players.size();
+        this->players.push_back(player);
+        this->players.back().id = id;
+    }
+    player.id = id;
+    return id;
+}
+
+void Grid::reset_cell(uint32_t index)
+{
+    Resource base;
+    base.circle = this->rng.bounded(2);
+    base.triangle = this->rng.bounded(2);
+    base.square = this->rng.bounded(2);
+    this->cells.owners[index] = 0;
+    this->cells.resources_base.set(index, base);
+    this->cells.resources.set(index, base); // no upgrades yet
+    this->cells.offense[index] = 0;
+    this->cells.defense[index] = 0;
+    this->cells.upgrades[index] = 0;
+}
+
+void FieldMeta::set_owner(Player &player)
+{
+    PlayerId owner = this->grid->players->add(player);
+    if (this->grid->cells.owners[this->index] == owner)
+        return;
+    this->grid->record(this->index);
+    this->grid->change_owner(this->index, owner);
+}
+
+void Grid::change_owner(uint32_t index, PlayerId owner)
+{
+    FieldMeta *meta = &(this->fields[index]);
+    this->detach_from_cluster(meta);
+    this->leave_frontier(meta);
+    this->field_counts[this->cells.owners[index]]--;
+    this->cells.owners[index] = owner;
+    if (owner >= this->field_counts.size())
+        this->field_counts.resize(owner + 1, 0);
+    this->field_counts[owner]++;
+    this->attach_to_cluster(meta);
+    this->update_frontier(meta);
+    this->owner_changed(meta);
+}
+
+void FieldMeta::consume_resources(Resource costs)
+{
+    this->grid->record(this->index);
+    Resource old_resources = this->grid->cells.resources.get(this->index);
+    this->grid->cells.resources.set(this->index, old_resources - costs);
+    this->grid->update_cluster_resources(this, old_resources);
+}
+
+void Grid::update_cluster_resources(FieldMeta *meta, Resource old_resources)
+{
+    Cluster &cluster = this->clusters[this->cluster_of[this->get_index(meta)]];
+    if (!this->is_summed(&cluster))
+        return;
+    cluster.resources -= old_resources;
+    cluster.resources += meta->get_resources();
+}
+
+Resource Grid::consume_resources_of_cluster(Cluster *cluster, Resource costs)
+{
+    static const Resource neutral = {0, 0, 0};
+    for (uint32_t member : cluster->members)
+    {
+        FieldMeta *meta = &(this->fields[member]);
+        if (costs == neutral) // paid in full, leave the other members alone
+            break;
+        // mind the "special" definition of -=, only byte of what you can chew or leave nothing behind
+        Resource tmp = costs;
+        costs -= meta->get_resources();
+        meta->consume_resources(tmp);
+        this->field_changed(meta);
+    }
+    return costs; // > {0, 0, 0} means there were not enough resources
+}
+
+bool Player::assess_fight(FieldMeta *field, Resource *costs, std::vector<Cluster *> *attackers_clusters)
+{
+    bool is_neighbor = false; // player has a field around here
+    Grid *grid = field->get_grid();
+    PlayerId attacker = grid->get_players()->find(*this);
+    PlayerId defender = field->get_owner_id();
+    // friendly fire or owned by default player
+    if (attacker == defender || defender == 0)
+    {
+        return false;
+    }
+    // defending player's Defense against attacking player's offense
+    int power_level = field->get_defense(); // it's over 9000
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        FieldMeta *neighbor = field->get_neighbor(i);
+        if (neighbor == nullptr) // there is no neighbor in this direction
+        {
+            continue;
+        }
+        if (neighbor->get_owner_id() == attacker) // attacking player
+        {
+            Cluster *neighbor_cluster = grid->get_cluster(neighbor);
+            if (std::find(attackers_clusters->begin(), attackers_clusters->end(), neighbor_cluster)
+                == attackers_clusters->end())
+            {
+                attackers_clusters->push_back(neighbor_cluster);
+            }
+            power_level -= neighbor->get_offense();
+            is_neighbor = true;
+        }
+        else if (neighbor->get_owner_id() == defender) // attacked player
+        {
+            power_level += neighbor->get_defense();
+        }
+        // else: ignore, field / player not part of the fight (e.g. default player)
+    }
+    *costs = {(uint32_t) std::abs(power_level), (uint32_t) std::abs(power_level), (uint32_t) std::abs(power_level)};
+    Resource attackers_resources = {0, 0, 0};
+    for (Cluster *cluster : *attackers_clusters)
+    {
+        attackers_resources += grid->get_resources_of_cluster(cluster);
+    }
+    return power_level < 2 && is_neighbor && *costs <= attackers_resources;
+}
+
+bool Player::fight(FieldMeta *field)
+{
+    TraceSpan span("Player::fight");
+    Grid *grid = field->get_grid();
+    Cluster *defenders_cluster = grid->get_cluster(field);
+    std::vector<Cluster *> attackers_clusters;
+    Resource costs = {0, 0, 0};
+    bool won = this->assess_fight(field, &costs, &attackers_clusters);
+    // the attacking clusters pay together, one after the other
+    Resource remaining_costs = costs;
+    for (Cluster *cluster : attackers_clusters)
+    {
+        remaining_costs = grid->consume_resources_of_cluster(cluster, remaining_costs);
+    }
+    if (won) // attacking player has won
+    {
+        grid->consume_resources_of_cluster(defenders_cluster, costs);
+        field->set_owner(*this);
+        return true;
+    }
+    else // lost
+    {
+        return false;
+    }
+}
+
+FieldMeta *Grid::get_field(Field field)
+{
+    int32_t index = this->field_index(field);
+    if (index < 0)
+        return nullptr;
+    return &(this->fields[index]);
+}
+
+bool Grid::place(Player &player, FieldMeta *center)
+{
+    std::vector<FieldMeta *> selected;
+    selected.push_back(center);
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        FieldMeta *neighbor = center->get_neighbor(i);
+        if (neighbor != nullptr && neighbor->get_owner_id() == 0)
+        {
+            selected.push_back(neighbor);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    static const Resource lower = {0, 0, 0};
+    Resource resources = {0, 0, 0};
+    for (auto r : selected)
+    {
+        resources += r->get_resources();
+    }
+    if (resources > lower)
+    {
+        for (auto i : selected)
+        {
+            i->set_owner(player);
+            i->set_offense(1);
+            i->set_defense(1);
+        }
+        return true;
+    }
+    return false;
+}
+
+void Grid::free(Player &player)
+{
+    PlayerId owner = this->players->find(player);
+    for (uint32_t index = 0; index < this->fields.size() && owner != NO_PLAYER; index++)
+    {
+        if (this->cells.owners[index] == owner)
+        {
+            this->field_counts[owner]--;
+            this->field_counts[0]++;
+            this->reset_cell(index);
+            this->log_change(index);
+            this->owner_changed(&(this->fields[index]));
+        }
+    }
+    this->build_clusters();
+    this->build_frontiers();
+}
+
+uint32_t Grid::count_fields(Player &player)
+{
+    return this->count_fields(this->players->find(player));
+}
+
+Grid &Grid::operator=(const Grid &other)
+{
+    if (this == &other)
+        return *this;
+    // the layout only depends on the radius
+    if (this->radius != other.radius || this->fields.size() != other.fields.size())
+    {
+        this->radius = other.radius;
+        this->fields.clear();
+        this->fields.reserve(other.fields.size());
+        for (uint32_t index = 0; index < other.fields.size(); index++)
+        {
+            this->fields.emplace_back(this, index);
+        }
+        this->row_offsets = other.row_offsets;
+        this->neighbors = other.neighbors;
+        this->visit_marks.assign(this->fields.size(), 0);
+        this->visit_searches.resize(this->fields.size());
+        this->visit_generation = 0;
+    }
+    this->cells = other.cells;
+    this->players = other.players;
+    this->rng = other.rng;
+    this->clusters = other.clusters;
+    this->free_clusters = other.free_clusters;
+    this->cluster_of = other.cluster_of;
+    this->member_positions = other.member_positions;
+    this->regenerations = other.regenerations;
+    this->threads = other.threads;
+    this->field_counts = other.field_counts;
+    this->frontiers = other.frontiers;
+    this->frontier_positions = other.frontier_positions;
+    this->journal.clear();
+    this->journaling = false;
+    this->changes.clear();
+    this->changes_dropped = 0;
+    this->followed = other.serial;
+    this->followed_position = other.changes_dropped + other.changes.size();
+    return *this;
+}
+
+void Grid::follow(const Grid &other)
+{
+    TraceSpan span("Grid::follow");
+    if (this->followed != other.serial || this->followed_position < other.changes_dropped)
+    {
+        *this = other;
+        return;
+    }
+    size_t begin = (size_t) (this->followed_position - other.changes_dropped);
+    // the fields that didn't change only need the last regeneration, the others are taken over as they are now
+    if (std::find(other.changes.begin() + begin, other.changes.end(), Grid::REGENERATION) != other.changes.end())
+        this->regenerate();
+    for (size_t i = begin; i < other.changes.size(); i++)
+    {
+        uint32_t index = other.changes[i];
+        if (index == Grid::REGENERATION)
+            continue;
+        this->cells.resources_base.set(index, other.cells.resources_base.get(index));
+        this->set_cell(index, other.cells.owners[index], other.cells.resources.get(index),
+                       other.cells.upgrades[index], other.cells.offense[index], other.cells.defense[index]);
+    }
+    this->rng = other.rng;
+    this->followed_position = other.changes_dropped + other.changes.size();
+}
+
+void Grid::set_cell(uint32_t index, PlayerId owner, Resource resources, uint16_t upgrades, int16_t offense,
+                    int16_t defense)
+{
+    this->record(index);
+    if (this->cells.owners[index] != owner)
+        this->change_owner(index, owner);
+    Resource old_resources = this->cells.resources.get(index);
+    this->cells.resources.set(index, resources);
+    this->update_cluster_resources(&(this->fields[index]), old_resources);
+    this->cells.upgrades[index] = upgrades;
+    this->cells.offense[index] = offense;
+    this->cells.defense[index] = defense;
+    this->field_changed(&(this->fields[index]));
+}
+
+void Grid::begin_journal()
+{
+    this->journal.clear();
+    this->journaling = true;
+    this->journal_rng = this->rng;
+}
+
+void Grid::rollback()
+{
+    this->journaling = false;
+    // newest first, so every field ends up in the state it had before its first change
+    for (auto entry = this->journal.rbegin(); entry != this->journal.rend(); entry++)
+    {
+        this->set_cell(entry->index, entry->owner, entry->resources, entry->upgrades, entry->offense, entry->defense);
+    }
+    this->journal.clear();
+    this->rng = this->journal_rng;
+}
+
+void Grid::regenerate()
+{
+    TraceSpan span("Grid::regenerate");
+    // one pass over the resource arrays, the sums of the clusters follow when they are used
+    ResourceArrays<uint8_t> &base = this->cells.resources_base;
+    ResourceArrays<uint16_t> &resources = this->cells.resources;
+    const uint8_t *base_kinds[3] = {base.circle.data(), base.triangle.data(), base.square.data()};
+    uint16_t *kinds[3] = {resources.circle.data(), resources.triangle.data(), resources.square.data()};
+    regenerate_resources(this->fields.size(), this->cells.upgrades.data(), base_kinds, kinds);
+    this->regenerations++;
+    this->log_change(Grid::REGENERATION);
+    this->all_fields_changed();
+}
+
+void Grid::reproduce_partition(const std::vector<uint32_t> &frontier, uint32_t partition, uint64_t seed,
+                               std::vector<uint32_t> &aquired)
+{
+    TraceSpan span("Grid::reproduce_partition");
+    // every partition rolls from its own stream, no matter which thread sweeps it
+    Pcg32 rng(seed, partition);
+    uint32_t begin = partition * Grid::PARTITION_SIZE;
+    uint32_t end = std::min(begin + Grid::PARTITION_SIZE, (uint32_t) frontier.size());
+    for (uint32_t position = begin; position < end; position++)
+    {
+        uint32_t index = frontier[position];
+        for (uint8_t i = 0; i < 6; i++)
+        {
+            int32_t neighbor = this->neighbors[6 * index + i];
+            if (neighbor >= 0 && this->cells.owners[neighbor] == 0)
+            {
+                double reproduction = this->fields[neighbor].get_reproduction();
+                if (reproduction > rng.uniform())
+                {
+                    aquired.push_back((uint32_t) neighbor);
+                }
+            }
+        }
+    }
+}
+
+void Grid::reproduce(Player &player)
+{
+    TraceSpan span("Grid::reproduce");
+    // only the frontier can grow, it is only read while sweeping
+    // and the partitions are fixed, so any number of threads gives the same result
+    const std::vector<uint32_t> &frontier = this->get_frontier(player);
+    uint32_t num_partitions = (uint32_t) ((frontier.size() + Grid::PARTITION_SIZE - 1) / Grid::PARTITION_SIZE);
+    uint64_t seed = ((uint64_t) this->rng() << 32) | this->rng();
+    std::vector<std::vector<uint32_t>> candidates(num_partitions);
+    std::atomic<uint32_t> next_partition(0);
+    auto sweep = [&]()
+    {
+        uint32_t partition;
+        while ((partition = next_partition++) < num_partitions)
+        {
+            this->reproduce_partition(frontier, partition, seed, candidates[partition]);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (uint32_t t = 1; t < std::min(this->threads, num_partitions); t++)
+    {
+        workers.push_back(std::thread(sweep));
+    }
+    sweep();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    // collected by index so the fields are taken over in the same order in every run
+    std::vector<uint32_t> aquired;
+    for (std::vector<uint32_t> &partition : candidates)
+    {
+        aquired.insert(aquired.end(), partition.begin(), partition.end());
+    }
+    std::sort(aquired.begin(), aquired.end());
+    aquired.erase(std::unique(aquired.begin(), aquired.end()), aquired.end());
+    for (uint32_t index : aquired)
+    {
+        FieldMeta *foo = &(this->fields[index]);
+        foo->set_owner(player);
+        foo->set_defense(1);
+        foo->set_offense(1);
+    }
+}
+
+Player &PlayerManager::get_current()
+{
+    if (this->order.empty())
+    {
+        return this->default_player;
+    }
+    else
+    {
+        return this->registry.get(this->order[this->current]);
+    }
+}
+
+bool PlayerManager::next_turn()
+{
+    this->current++;
+    if (this->current >= this->order.size())
+    {
+        this->current = 0;
+        return true;
+    }
+    return false;
+}
+
+void PlayerManager::shuffle(Pcg32 &rng)
+{
+    // Fisher-Yates, std::shuffle may differ between standard libraries
+    for (uint32_t i = (uint32_t) this->order.size(); i > 1; i--)
+    {
+        std::swap(this->order[i - 1], this->order[rng.bounded(i)]);
+    }
+    this->current = 0;
+}
+
+void PlayerManager::add_player(Player &player)
+{
+    this->order.push_back(this->registry.add(player));
+    this->current = 0;
+}
+
+void PlayerManager::surrender(Player &player, Grid *grid)
+{
+    grid->free(player);
+    //players.erase(std::remove(players.begin(), players.end(), player), players.end());
+}
+
+bool PlayerManager::init()
+{
+    pm = new PlayerManager();
+    if (pm)
+    {
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+bool PlayerManager::destroy()
+{
+    if (pm != nullptr)
+    {
+        delete pm;
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+bool Simulation::add_player(Player &player, Field center)
+{
+    FieldMeta *field = this->grid.get_field(center);
+    if (this->started || field == nullptr || !this->grid.place(player, field))
+        return false;
+    this->players.add_player(player);
+    return true;
+}
+
+void Simulation::start()
+{
+    this->players.shuffle(this->grid.get_rng());
+    this->started = true;
+    this->grid.regenerate();
+    this->grid.reproduce(this->players.get_current());
+}
+
+void Simulation::next_turn()
+{
+    if (!this->started)
+        return;
+    this->turn++;
+    if (this->players.next_turn())
+    {
+        this->grid.regenerate();
+    }
+    this->grid.reproduce(this->players.get_current());
+}
@@ -0,0 +1,886 @@
+#ifndef _SIMULATION_H
+#define _SIMULATION_H
+
+#include <random>
+#include <sstream>
+#include <string>
+#include <iostream>
+#include <stdexcept>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+#include <bitset>
+#include <unordered_set>
+#include <unordered_map>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include "Random.hpp"
+#include "Regeneration.hpp"
+#include "Trace.hpp"
+
+struct Field
+{
+    int16_t x, y, z;
+
+    Field(int16_t x_, int16_t y_, int16_t z_) : x(x_), y(y_), z(z_)
+    {
+        assert(x + y + z == 0);
+    }
+
+    inline bool operator==(const Field &rhs) const
+    {
+        return (this->x == rhs.x && this->y == rhs.y);
+    }
+
+    inline bool operator!=(const Field &rhs) const
+    {
+        return !(*this == rhs);
+    }
+
+    Field &operator+=(const Field &rhs)
+    {
+        this->x += rhs.x;
+        this->y += rhs.y;
+        this->z += rhs.z;
+        return *this;
+    }
+
+    friend Field operator+(Field lhs, const Field &rhs)
+    {
+        lhs += rhs;
+        return lhs;
+    }
+
+    Field &operator-=(const Field &rhs)
+    {
+        this->x -= rhs.x;
+        this->y -= rhs.y;
+        this->z -= rhs.z;
+        return *this;
+    }
+
+    friend Field operator-(Field lhs, const Field &rhs)
+    {
+        lhs -= rhs;
+        return rhs;
+    }
+
+    Field &operator*=(const Field &rhs)
+    {
+        this->x *= rhs.x;
+        this->y *= rhs.y;
+        this->z *= rhs.z;
+        return *this;
+    }
+
+    friend Field operator*(Field lhs, const Field &rhs)
+    {
+        lhs *= rhs;
+        return rhs;
+    }
+
+    Field &operator/=(const Field &rhs)
+    {
+        double x = this->x / rhs.x;
+        double y = this->y / rhs.y;
+        double z = this->z / rhs.z;
+        Field f = cubic_round(x, y, z);
+        *this = f;
+        return *this;
+    }
+
+    friend Field operator/(Field lhs, const Field &rhs)
+    {
+        lhs /= rhs;
+        return lhs;
+    }
+
+    Field &operator*=(const double &rhs)
+    {
+        double x = this->x * rhs;
+        double y = this->y * rhs;
+        double z = this->z * rhs;
+        Field f = cubic_round(x, y, z);
+        *this = f;
+        return *this;
+    }
+
+    friend Field operator*(Field lhs, const double &rhs)
+    {
+        lhs *= rhs;
+        return lhs;
+    }
+
+    Field &operator/=(const double &rhs)
+    {
+        double x = this->x / rhs;
+        double y = this->y / rhs;
+        double z = this->z / rhs;
+        Field f = cubic_round(x, y, z);
+        *this = f;
+        return *this;
+    }
+
+    friend Field operator/(Field lhs, const double &rhs)
+    {
+        lhs /= rhs;
+        return lhs;
+    }
+
+    int operator&(const Field &rhs)
+    {
+        return (abs(this->x - rhs.x) + abs(this->y - rhs.y) + abs(this->z - rhs.z)) / 2;
+    }
+
+    Field get_neighbor(uint8_t direction) const;
+
+    static Field cubic_round(double x, double y, double z);
+
+    static Field hex_direction(uint8_t direction);
+};
+
+// from upper right corner
+const std::vector<Field> hex_directions = {{+1, -1, 0},
+                                           {+1, 0,  -1},
+                                           {0,  +1, -1},
+                                           {-1, +1, 0},
+                                           {-1, 0,  +1},
+                                           {0,  -1, +1}};
+
+namespace std
+{
+    template<>
+    struct hash<Field>
+    {
+        size_t operator()(const Field &f) const
+        {
+            hash<int16_t> int_hash;
+            size_t hx = int_hash(f.x);
+            size_t hy = int_hash(f.y);
+            // hz would be redundant, since f.z is redundant
+            // combine hashes
+            return hx ^ (hy + 0x9e3779b9 + (hx << 6) + (hx >> 2));
+        }
+    };
+}
+
+inline std::ostream &operator<<(std::ostream &os, const Field &rhs)
+{
+    os << "(" << rhs.x << "," << rhs.y << ",";
+    return os;
+}
+
+struct Resource
+{
+    uint32_t circle;
+    uint32_t triangle;
+    uint32_t square;
+
+    Resource &operator+=(const Resource &rhs)
+    {
+        this->circle += rhs.circle;
+        this->triangle += rhs.triangle;
+        this->square += rhs.square;
+        return *this;
+    }
+
+    friend Resource operator+(Resource lhs, const Resource &rhs)
+    {
+        lhs += rhs;
+        return lhs;
+    }
+
+    Resource &operator-=(const Resource &rhs)
+    {
+        if (this->circle < rhs.circle)
+            this->circle = 0;
+        else
+            this->circle -= rhs.circle;
+
+        if (this->triangle < rhs.triangle)
+            this->triangle = 0;
+        else
+            this->triangle -= rhs.triangle;
+
+        if (this->square < rhs.square)
+            this->square = 0;
+        else
+            this->square -= rhs.square;
+
+        return *this;
+    }
+
+    friend Resource operator-(Resource lhs, const Resource &rhs)
+    {
+        lhs -= rhs;
+        return lhs;
+    }
+
+    Resource &operator*=(const Resource &rhs)
+    {
+        this->circle *= rhs.circle;
+        this->triangle *= rhs.triangle;
+        this->square *= rhs.square;
+        return *this;
+    }
+
+    friend Resource operator*(Resource lhs, const Resource &rhs)
+    {
+        lhs *= rhs;
+        return lhs;
+    }
+
+    Resource &operator*=(const double rhs)
+    {
+        this->circle *= rhs;
+        this->triangle *= rhs;
+        this->square *= rhs;
+        return *this;
+    }
+
+    friend Resource operator*(const double lhs, Resource rhs)
+    {
+        rhs *= lhs;
+        return rhs;
+    }
+
+    friend Resource operator*(Resource lhs, const double rhs)
+    {
+        return rhs * lhs;
+    }
+
+    bool operator<(const Resource &rhs) const
+    {
+        return (this->circle < rhs.circle || this->triangle < rhs.triangle || this->square < rhs.square);
+    }
+
+    inline bool operator>(const Resource &rhs) const { return rhs < *this; }
+
+    inline bool operator<=(const Resource &rhs) const { return !(*this > rhs); }
+
+    inline bool operator>=(const Resource &rhs) const { return !(*this < rhs); }
+
+    bool operator==(const Resource &rhs) const
+    {
+        return (this->circle == rhs.circle && this->triangle == rhs.triangle && this->square == rhs.square);
+    }
+
+    inline bool operator!=(const Resource &rhs) const { return !(*this == rhs); }
+};
+
+enum Upgrade
+{
+    Regeneration_1,
+    Regeneration_2,
+    Regeneration_3,
+    Reproduction_1,
+    Reproduction_2,
+    Reproduction_3,
+    Offense_1,
+    Offense_2,
+    Offense_3,
+    Defense_1,
+    Defense_2,
+    Defense_3,
+};
+
+const std::vector<Upgrade> UPGRADES = {Regeneration_1, Regeneration_2, Regeneration_3, Reproduction_1, Reproduction_2,
+                                       Reproduction_3, Offense_1, Offense_2, Offense_3, Defense_1, Defense_2, Defense_3
+};
+
+const int NUM_UPGRADES = 12;
+
+static_assert(Regeneration_1 == 0 && Regeneration_2 == 1 && Regeneration_3 == 2,
+              "regeneration_shift expects the regeneration upgrades in the lowest bits");
+
+typedef std::bitset<NUM_UPGRADES> UpgradeFlags;
+
+namespace std
+{
+    template<>
+    struct hash<Upgrade>
+    {
+        size_t operator()(const Upgrade &f) const
+        {
+            int i = static_cast<int>(f);
+            hash<int> int_hash;
+            return int_hash(f);
+        }
+    };
+}
+
+const std::unordered_map<Upgrade, Resource> UPGRADE_COSTS(
+        {
+                {Regeneration_1, {4,  4,  4}},
+                {Regeneration_2, {8,  8,  8}},
+                {Regeneration_3, {16, 16, 16}},
+                {Reproduction_1, {4,  4,  4}},
+                {Reproduction_2, {8,  8,  8}},
+                {Reproduction_3, {16, 16, 16}},
+                {Offense_1,      {4,  4,  4}},
+                {Offense_2,      {8,  8,  8}},
+                {Offense_3,      {16, 16, 16}},
+                {Defense_1,      {4,  4,  4}},
+                {Defense_2,      {8,  8,  8}},
+                {Defense_3,      {16, 16, 16}}
+        }
+);
+
+const std::unordered_map<Upgrade, std::string> UPGRADE_NAMES(
+        {
+                {Regeneration_1, "Regeneration 1"},
+                {Regeneration_2, "Regeneration 2"},
+                {Regeneration_3, "Regeneration 3"},
+                {Reproduction_1, "Reproduction 1"},
+                {Reproduction_2, "Reproduction 2"},
+                {Reproduction_3, "Reproduction 3"},
+                {Offense_1,      "Offense 1"},
+                {Offense_2,      "Offense 2"},
+                {Offense_3,      "Offense 3"},
+                {Defense_1,      "Defense 1"},
+                {Defense_2,      "Defense 2"},
+                {Defense_3,      "Offense 3"}
+        }
+);
+
+
+const std::unordered_map<Upgrade, std::string> UPGRADE_TEXTS(
+        {
+                {Regeneration_1, "Resources yield 2x their base resources per turn."},
+                {Regeneration_2, "Resources yield 4x their base resources per turn."},
+                {Regeneration_3, "Resources yield 8x their base resources per turn."},
+                {Reproduction_1, "Increase the chance for expanding to a new field at the end of the turn by 5%."},
+                {Reproduction_2, "Increase the chance for expanding to a new field at the end of the turn by 10%."},
+                {Reproduction_3, "Increase the chance for expanding to a new field at the end of the turn by 20%."},
+                {Offense_1,      "Double your offense."},
+                {Offense_2,      "Double your offense."},
+                {Offense_3,      "Double your offense."},
+                {Defense_1,      "Double your defense."},
+                {Defense_2,      "Double your defense."},
+                {Defense_3,      "Double your defense."}
+        }
+);
+
+struct Color
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a;
+};
+
+class FieldMeta;
+
+struct Cluster;
+
+// position of a player in the registry of its game
+typedef uint16_t PlayerId;
+
+const PlayerId NO_PLAYER = UINT16_MAX;
+
+class Player
+{
+public:
+    Player()
+            : name("Default Player"), uuid(boost::uuids::nil_uuid()), id(0) { }
+
+    Player(std::string name_)
+            : name(name_), uuid(boost::uuids::basic_random_generator<boost::mt19937>()()), id(NO_PLAYER)
+    {
+        // use the last 24 bits of the tag for the color
+        boost::uuids::uuid id = this->uuid;
+        uint8_t *data = id.data;
+        this->color = {data[13], data[14], data[15], 0xff};
+    }
+
+    Color get_color() { return this->color; }
+
+    std::string get_name()
+    {
+        std::ostringstream descriptor;
+        int number = (this->uuid.data[0] << 8) | this->uuid.data[1];
+        descriptor << this->name << " (" << std::hex << number << ")";
+        return descriptor.str();
+    }
+
+    bool fight(FieldMeta *field);
+
+    // whether an attack on field would be won and what it costs, without carrying it out
+    bool assess_fight(FieldMeta *field, Resource *costs, std::vector<Cluster *> *attackers_clusters);
+
+    boost::uuids::uuid get_id() { return this->uuid; }
+
+    inline bool operator==(const Player &rhs) const
+    {
+        return this->uuid == rhs.uuid;
+    }
+
+    inline bool operator!=(const Player &rhs) const
+    {
+        return !(*this == rhs);
+    }
+
+private:
+    friend class PlayerRegistry;
+    boost::uuids::uuid uuid;
+    Color color;
+    std::string name;
+    PlayerId id; // in the registry it was last added to, a hint only
+};
+
+// every player of a game once, fields and frontiers refer to them by id, the default player has id 0
+class PlayerRegistry
+{
+public:
+    PlayerRegistry()
+    {
+        this->players.push_back(Player());
+    }
+
+    // registers player on its first use
+    PlayerId add(Player &player);
+
+    // NO_PLAYER if player was never added
+    PlayerId find(const Player &player);
+
+    Player &get(PlayerId id) { return this->players[id]; }
+
+    size_t size() { return this->players.size(); }
+
+private:
+    std::deque<Player> players; // references stay valid while players are added
+};
+
+class Grid;
+
+// resources of all fields, an array per kind so they can be processed in bulk,
+// in the smallest type holding them to keep the bulk passes short
+template<typename T>
+struct ResourceArrays
+{
+    std::vector<T> circle;
+    std::vector<T> triangle;
+    std::vector<T> square;
+
+    Resource get(uint32_t index) const
+    {
+        return {this->circle[index], this->triangle[index], this->square[index]};
+    }
+
+    void set(uint32_t index, Resource resource)
+    {
+        assert(resource.circle <= std::numeric_limits<T>::max() && resource.triangle <= std::numeric_limits<T>::max()
+               && resource.square <= std::numeric_limits<T>::max());
+        this->circle[index] = (T) resource.circle;
+        this->triangle[index] = (T) resource.triangle;
+        this->square[index] = (T) resource.square;
+    }
+
+    void resize(size_t size)
+    {
+        this->circle.resize(size);
+        this->triangle.resize(size);
+        this->square.resize(size);
+    }
+};
+
+// state of all fields, one array per attribute so passes over the whole grid only stream what they read
+struct CellStore
+{
+    std::vector<Field> positions;
+    std::vector<PlayerId> owners;
+    // base resources are 0 or 1, regeneration multiplies them by 64 at most and nothing else adds to them
+    ResourceArrays<uint8_t> resources_base; // without upgrades applied, used as basis of regeneration
+    ResourceArrays<uint16_t> resources; // actual current resources
+    std::vector<int16_t> offense;
+    std::vector<int16_t> defense;
+    std::vector<uint16_t> upgrades; // a bit per Upgrade, like UpgradeFlags
+
+    void resize(size_t size)
+    {
+        this->owners.resize(size);
+        this->resources_base.resize(size);
+        this->resources.resize(size);
+        this->offense.resize(size);
+        this->defense.resize(size);
+        this->upgrades.resize(size);
+    }
+
+    // every upgrade of the kind doubles, first is the first of the three levels
+    static int upgrade_factor(uint16_t upgrades, Upgrade first)
+    {
+        return 1 << (((upgrades >> first) & 1) + ((upgrades >> (first + 1)) & 1) + ((upgrades >> (first + 2)) & 1));
+    }
+};
+
+// a field of the grid, only a view of its state in the grid's cell store
+class FieldMeta
+{
+public:
+    FieldMeta(Grid *grid_, uint32_t index_)
+            : grid(grid_), index(index_) { }
+
+    Grid *get_grid() { return this->grid; }
+
+    void set_grid(Grid *grid_) { this->grid = grid_; }
+
+    int get_offense();
+    int get_defense();
+    void set_offense(int off);
+    void set_defense(int def);
+    Field get_field();
+    Player &get_owner();
+    PlayerId get_owner_id();
+    void set_owner(Player &player);
+    Resource get_resources();
+    Resource get_resources_base();
+    UpgradeFlags get_upgrades();
+    void consume_resources(Resource costs);
+    bool upgrade(Upgrade upgrade);
+    FieldMeta *get_neighbor(uint8_t direction);
+    double get_reproduction();
+private:
+    Grid *grid;
+    uint32_t index;
+};
+
+// connected fields of a single owner, maintained by the grid's cluster index
+struct Cluster
+{
+    std::vector<uint32_t> members; // indices of the fields
+    Resource resources; // sum of the members' resources
+    uint32_t regeneration; // the sum is stale if this isn't the grid's current regeneration
+};
+
+class PlayerManager
+{
+public:
+    PlayerManager()
+    {
+        this->current = 0;
+    }
+
+    Player &get_current();
+
+    // returns true if a new round has begun
+    bool next_turn();
+
+    void shuffle(Pcg32 &rng);
+
+    void surrender(Player &player, Grid *grid);
+
+    void add_player(Player &player);
+
+    long get_num_players() { return this->order.size(); }
+
+    PlayerRegistry *get_registry() { return &(this->registry); }
+
+    Player default_player;
+    static PlayerManager *pm;
+
+    static bool init();
+
+    static bool destroy();
+
+private:
+    PlayerRegistry registry;
+    std::vector<PlayerId> order; // of the turns
+    size_t current;
+};
+
+// the game state of a hexagon shaped board, without any presentation
+class Grid
+{
+public:
+    Grid(int16_t grid_radius, PlayerRegistry *players_, uint64_t seed = 0, uint64_t stream = 0)
+            : radius(grid_radius), players(players_), rng(seed, stream)
+    {
+        // the hexagon is stored row by row (x), each row is a contiguous run of y values
+        uint32_t num_fields = 3 * grid_radius * (grid_radius + 1) + 1;
+        this->fields.reserve(num_fields);
+        this->cells.positions.reserve(num_fields);
+        this->row_offsets.reserve(2 * grid_radius + 1);
+        for (int16_t x = -grid_radius; x <= grid_radius; x++)
+        {
+            this->row_offsets.push_back(this->fields.size());
+            int16_t y_l = (-grid_radius > -x - grid_radius) ? -grid_radius : -x - grid_radius;
+            int16_t y_u = (grid_radius < -x + grid_radius) ? grid_radius : -x + grid_radius;
+            for (int16_t y = y_l; y <= y_u; y++)
+            {
+                int16_t z = -x - y;
+                this->fields.emplace_back(this, (uint32_t) this->fields.size());
+                this->cells.positions.push_back(Field(x, y, z));
+            }
+        }
+        this->cells.resize(this->fields.size());
+        for (uint32_t index = 0; index < this->fields.size(); index++)
+        {
+            this->reset_cell(index);
+        }
+        // precompute the neighborhood, -1 marks a direction leading off the grid
+        this->neighbors.resize(6 * this->fields.size());
+        for (uint32_t index = 0; index < this->fields.size(); index++)
+        {
+            for (uint8_t i = 0; i < 6; i++)
+            {
+                this->neighbors[6 * index + i] = this->field_index(this->cells.positions[index].get_neighbor(i));
+            }
+        }
+        this->cluster_of.resize(this->fields.size());
+        this->member_positions.resize(this->fields.size());
+        this->visit_marks.assign(this->fields.size(), 0);
+        this->visit_searches.resize(this->fields.size());
+        this->visit_generation = 0;
+        this->regenerations = 0;
+        this->threads = 1;
+        this->journaling = false;
+        this->changes_dropped = 0;
+        this->serial = Grid::next_serial++;
+        this->followed = 0;
+        this->followed_position = 0;
+        this->field_counts.assign(1, (uint32_t) this->fields.size());
+        this->build_clusters();
+        this->build_frontiers();
+    }
+
+    // copies the state only, the copy has no presentation attached
+    Grid(const Grid &other)
+            : radius(0), players(other.players), rng(other.rng)
+    {
+        this->visit_generation = 0;
+        this->serial = Grid::next_serial++;
+        *this = other;
+    }
+
+    // takes over the state of other, a grid of the same radius keeps its layout, so this is a plain copy of the arrays
+    Grid &operator=(const Grid &other);
+
+    // brings a copy of other up to date by taking over the fields other logged as changed since the last call,
+    // everything is copied the first time or if other dropped some of these changes meanwhile
+    void follow(const Grid &other);
+
+    virtual ~Grid() { }
+
+    FieldMeta *get_neighbor(FieldMeta *field, uint8_t direction);
+    Cluster *get_cluster(FieldMeta *field);
+    int16_t get_grid_radius() { return this->radius; }
+    uint32_t get_num_fields() { return (uint32_t) this->fields.size(); }
+    Resource get_resources_of_cluster(Cluster *cluster);
+    Resource consume_resources_of_cluster(Cluster *cluster, Resource costs);
+    FieldMeta *get_field(Field field);
+    FieldMeta *get_field(uint32_t index) { return &(this->fields[index]); }
+    uint32_t get_index(FieldMeta *meta) { return (uint32_t) (meta - this->fields.data()); }
+    uint32_t count_fields(Player &player);
+    uint32_t count_fields(PlayerId owner) { return owner < this->field_counts.size() ? this->field_counts[owner] : 0; }
+    // shared by copies of the grid
+    PlayerRegistry *get_players() { return this->players; }
+    // all randomness of the game is drawn from here, seeding it replays a game
+    Pcg32 &get_rng() { return this->rng; }
+    // threads sweeping the frontier in reproduce, the result is the same for any number
+    void set_threads(uint32_t threads_) { this->threads = std::max(1u, threads_); }
+
+    bool place(Player &player, FieldMeta *center);
+    void free(Player &player);
+    // start of a round: every field regenerates its resources
+    void regenerate();
+    // start of a turn: the player expands to free neighboring fields
+    void reproduce(Player &player);
+
+    void attach_to_cluster(FieldMeta *meta);
+    void detach_from_cluster(FieldMeta *meta);
+    // fields of the player bordering a field of someone else, in no particular order
+    const std::vector<uint32_t> &get_frontier(Player &player);
+    const std::vector<uint32_t> &get_frontier(PlayerId owner);
+    // before and after the owner of meta changes, keeps the frontiers of meta and its neighbors up to date
+    void leave_frontier(FieldMeta *meta);
+    void update_frontier(FieldMeta *meta);
+    void update_cluster_resources(FieldMeta *meta, Resource old_resources);
+
+    // undo journal for trying moves: every change of a field after begin_journal is taken back by rollback,
+    // together with the random generator, the cost is that of the changes and not of the grid
+    void begin_journal();
+    void rollback();
+
+    // notifications for a presentation of the grid
+    virtual void field_changed(FieldMeta *) { }
+    // every field changed at once, instead of a field_changed for each
+    virtual void all_fields_changed() { }
+    virtual void field_upgraded(FieldMeta *) { }
+    virtual void owner_changed(FieldMeta *) { }
+protected:
+    friend class FieldMeta;
+    std::vector<FieldMeta> fields;
+    CellStore cells;
+    // rolls new base resources, the field belongs to nobody afterwards
+    void reset_cell(uint32_t index);
+    // moves the field to the cluster and frontier of its new owner
+    void change_owner(uint32_t index, PlayerId owner);
+    // overwrites the state of the field, keeping the cluster index, frontiers and sums up to date
+    void set_cell(uint32_t index, PlayerId owner, Resource resources, uint16_t upgrades, int16_t offense,
+                  int16_t defense);
+    int16_t radius;
+    PlayerRegistry *players;
+    Pcg32 rng;
+    int32_t field_index(Field field);
+private:
+    std::vector<uint32_t> row_offsets;
+    std::vector<int32_t> neighbors;
+    // cluster index: every field is labeled with the cluster it belongs to
+    std::vector<Cluster> clusters;
+    std::vector<uint32_t> free_clusters;
+    std::vector<uint32_t> cluster_of;
+    std::vector<uint32_t> member_positions;
+    // after a regeneration the sums of the clusters are stale, changes of the members aren't added to them
+    // and a sum is only rebuilt when it is asked for, most clusters are never looked at
+    uint32_t regenerations;
+    bool is_summed(Cluster *cluster) { return cluster->regeneration == this->regenerations; }
+    void refresh_sum(Cluster *cluster);
+    // scratch space for searches, a field is visited if its mark equals the generation
+    std::vector<uint32_t> visit_marks;
+    std::vector<uint8_t> visit_searches;
+    uint32_t visit_generation;
+    uint32_t threads;
+    std::vector<uint32_t> field_counts; // by player id
+    // the state of a field before a change while journaling
+    struct JournalEntry
+    {
+        uint32_t index;
+        PlayerId owner;
+        uint16_t upgrades;
+        int16_t offense;
+        int16_t defense;
+        Resource resources;
+    };
+    std::vector<JournalEntry> journal;
+    bool journaling;
+    Pcg32 journal_rng;
+    // change log for the copies following the grid: indices of the changed fields and REGENERATION for a round,
+    // it's dropped once it gets longer than replaying it is worth, changes_dropped counts the entries dropped so far
+    static const uint32_t REGENERATION = UINT32_MAX;
+    std::vector<uint32_t> changes;
+    uint64_t changes_dropped;
+    void log_change(uint32_t index)
+    {
+        if (this->changes.size() > this->fields.size() / 8 + 64)
+        {
+            this->changes_dropped += this->changes.size();
+            this->changes.clear();
+        }
+        this->changes.push_back(index);
+    }
+    // the grid followed by this copy and the entries of its log taken over, serials tell grids apart
+    static uint64_t next_serial;
+    uint64_t serial;
+    uint64_t followed;
+    uint64_t followed_position;
+    // before every change of a field
+    void record(uint32_t index)
+    {
+        if (this->journaling)
+            this->journal.push_back({index, this->cells.owners[index], this->cells.upgrades[index],
+                                     this->cells.offense[index], this->cells.defense[index],
+                                     this->cells.resources.get(index)});
+        this->log_change(index);
+    }
+    static const uint32_t PARTITION_SIZE = 1024; // frontier fields per reproduction partition
+    void reproduce_partition(const std::vector<uint32_t> &frontier, uint32_t partition, uint64_t seed,
+                             std::vector<uint32_t> &aquired);
+    uint32_t new_cluster();
+    void add_member(uint32_t cluster, uint32_t index);
+    void remove_member(uint32_t index);
+    void build_clusters();
+    // frontier index: position of every field in its owner's frontier, -1 if it isn't part of it
+    std::vector<std::vector<uint32_t>> frontiers; // by player id
+    std::vector<uint32_t> frontier_positions;
+    bool is_frontier(uint32_t index);
+    void add_to_frontier(uint32_t index);
+    void remove_from_frontier(uint32_t index);
+    void build_frontiers();
+    void split_cluster(uint32_t cluster, const std::vector<uint32_t> &seeds);
+};
+
+// headless game: a grid, its players and the turn order, advanced step by step
+class Simulation
+{
+public:
+    // games with the same seed and stream play the same, a stream per thread keeps parallel games apart
+    Simulation(int16_t grid_radius, uint64_t seed = 0, uint64_t stream = 0)
+            : grid(grid_radius, players.get_registry(), seed, stream)
+    {
+        this->started = false;
+        this->turn = 0;
+    }
+
+    Grid *get_grid() { return &(this->grid); }
+
+    PlayerManager *get_players() { return &(this->players); }
+
+    Player &get_current() { return this->players.get_current(); }
+
+    uint32_t get_turn() { return this->turn; }
+
+    // claims the center and its neighbors for a new player, only before the game has started
+    bool add_player(Player &player, Field center);
+
+    void start();
+
+    // ends the current player's turn
+    void next_turn();
+
+private:
+    PlayerManager players;
+    Grid grid;
+    bool started;
+    uint32_t turn;
+};
+
+inline int FieldMeta::get_offense()
+{
+    return this->grid->cells.offense[this->index] * CellStore::upgrade_factor(this->grid->cells.upgrades[this->index],
+                                                                             Offense_1);
+}
+
+inline int FieldMeta::get_defense()
+{
+    return this->grid->cells.offense[this->index] * CellStore::upgrade_factor(this->grid->cells.upgrades[this->index],
+                                                                             Defense_1);
+}
+
+inline void FieldMeta::set_offense(int off)
+{
+    this->grid->record(this->index);
+    this->grid->cells.offense[this->index] = (int16_t) off;
+}
+
+inline void FieldMeta::set_defense(int def)
+{
+    this->grid->record(this->index);
+    this->grid->cells.defense[this->index] = (int16_t) def;
+}
+
+inline Field FieldMeta::get_field() { return this->grid->cells.positions[this->index]; }
+
+inline Player &FieldMeta::get_owner() { return this->grid->players->get(this->grid->cells.owners[this->index]); }
+
+inline PlayerId FieldMeta::get_owner_id() { return this->grid->cells.owners[this->index]; }
+
+inline Resource FieldMeta::get_resources() { return this->grid->cells.resources.get(this->index); }
+
+inline Resource FieldMeta::get_resources_base() { return this->grid->cells.resources_base.get(this->index); }
+
+inline UpgradeFlags FieldMeta::get_upgrades() { return UpgradeFlags(this->grid->cells.upgrades[this->index]); }
+
+inline double FieldMeta::get_reproduction()
+{
+    uint16_t upgrades = this->grid->cells.upgrades[this->index];
+    return ((upgrades >> Reproduction_1) & 1) * 0.05 + ((upgrades >> Reproduction_2) & 1) * 0.1
+           + ((upgrades >> Reproduction_3) & 1) * 0.2 + 0.01;
+}
+
+#endif
@@ -0,0 +1,123 @@
+#include "Trace.hpp"
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Trace::recording(false);
+std::chrono::steady_clock::time_point Trace::started = std::chrono::steady_clock::now();
+
+struct TraceEvent
+{
+    const char *name;
+    const char *category;
+    uint64_t begin;
+    uint64_t end;
+};
+
+// written by its thread only, written is published after the event is complete
+struct TraceBuffer
+{
+    std::vector<TraceEvent> events;
+    std::atomic<uint64_t> written;
+    uint32_t thread;
+};
+
+static std::mutex buffers_mutex;
+static std::vector<TraceBuffer *> buffers; // every buffer ever handed out, kept until the program ends
+static std::vector<TraceBuffer *> free_buffers; // of threads that have ended
+
+// the threads of the reproduction sweep come and go every turn, their buffers are reused
+struct BufferHolder
+{
+    TraceBuffer *buffer = nullptr;
+
+    ~BufferHolder()
+    {
+        if (this->buffer != nullptr)
+        {
+            std::lock_guard<std::mutex> lock(buffers_mutex);
+            free_buffers.push_back(this->buffer);
+        }
+    }
+};
+
+static thread_local BufferHolder holder;
+
+static TraceBuffer *thread_buffer()
+{
+    if (holder.buffer == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        if (!free_buffers.empty())
+        {
+            holder.buffer = free_buffers.back();
+            free_buffers.pop_back();
+        }
+        else
+        {
+            TraceBuffer *buffer = new TraceBuffer();
+            buffer->events.resize(Trace::BUFFER_SIZE);
+            buffer->written.store(0);
+            buffer->thread = (uint32_t) buffers.size();
+            buffers.push_back(buffer);
+            holder.buffer = buffer;
+        }
+    }
+    return holder.buffer;
+}
+
+void Trace::start()
+{
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        for (TraceBuffer *buffer : buffers)
+        {
+            buffer->written.store(0);
+        }
+    }
+    Trace::started = std::chrono::steady_clock::now();
+    Trace::recording.store(true);
+}
+
+void Trace::stop()
+{
+    Trace::recording.store(false);
+}
+
+void Trace::record(const char *name, const char *category, uint64_t begin, uint64_t end)
+{
+    TraceBuffer *buffer = thread_buffer();
+    uint64_t written = buffer->written.load(std::memory_order_relaxed);
+    buffer->events[written % Trace::BUFFER_SIZE] = {name, category, begin, end};
+    buffer->written.store(written + 1, std::memory_order_release);
+}
+
+bool Trace::write(const std::string &path)
+{
+    std::ofstream out(path);
+    out.setf(std::ios::fixed);
+    out.precision(3);
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    for (TraceBuffer *buffer : buffers)
+    {
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        if (written == 0)
+            continue;
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread
+        << ",\"args\":{\"name\":\"thread " << buffer->thread << "\"}}";
+        first = false;
+        // timestamps and durations in microseconds
+        uint64_t from = written > Trace::BUFFER_SIZE ? written - Trace::BUFFER_SIZE : 0;
+        for (uint64_t i = from; i < written; i++)
+        {
+            const TraceEvent &event = buffer->events[i % Trace::BUFFER_SIZE];
+            out << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category << "\",\"ph\":\"X\",\"ts\":"
+            << event.begin / 1000.0 << ",\"dur\":" << (event.end - event.begin) / 1000.0 << ",\"pid\":1,\"tid\":"
+            << buffer->thread << "}";
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return (bool) out;
+}
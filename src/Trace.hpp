@@ -0,0 +1,65 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// opt-in timeline of spans, written as Chrome trace events for chrome://tracing or ui.perfetto.dev,
+// every thread records into its own ring buffer without locking
+class Trace
+{
+public:
+    static void start();
+
+    static void stop();
+
+    static bool enabled() { return Trace::recording.load(std::memory_order_relaxed); }
+
+    // nanoseconds since the trace was started
+    static uint64_t now()
+    {
+        return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - Trace::started).count();
+    }
+
+    // name and category have to outlive the trace, string literals are
+    static void record(const char *name, const char *category, uint64_t begin, uint64_t end);
+
+    // all buffered spans, call it while no other thread is recording
+    static bool write(const std::string &path);
+
+    // spans kept per thread, older ones are overwritten
+    static const size_t BUFFER_SIZE = 16384;
+private:
+    static std::atomic<bool> recording;
+    static std::chrono::steady_clock::time_point started;
+};
+
+// records its lifetime as a span while tracing
+class TraceSpan
+{
+public:
+    TraceSpan(const char *name_, const char *category_ = "sim")
+            : name(name_), category(category_)
+    {
+        // spans that began before the trace was started are left out, as are spans without a name
+        this->active = this->name != nullptr && Trace::enabled();
+        this->begin = this->active ? Trace::now() : 0;
+    }
+
+    ~TraceSpan()
+    {
+        if (this->active && Trace::enabled())
+            Trace::record(this->name, this->category, this->begin, Trace::now());
+    }
+
+private:
+    const char *name;
+    const char *category;
+    bool active;
+    uint64_t begin;
+};
+
+#endif
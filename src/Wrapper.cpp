@@ -35,6 +35,26 @@ void Renderer::fill_rect(SDL_Rect *rect)
     }
 }
 
+void Renderer::set_clip_rect(const SDL_Rect *rect)
+{
+    if (SDL_RenderSetClipRect(this->renderer, rect) < 0)
+    {
+        throw SDL_RendererException();
+    }
+}
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+void Renderer::render_geometry(SDL_Texture *texture, const std::vector<SDL_Vertex> &vertices,
+                               const std::vector<int> &indices)
+{
+    if (SDL_RenderGeometry(this->renderer, texture, vertices.data(), (int) vertices.size(), indices.data(),
+                           (int) indices.size()) < 0)
+    {
+        throw SDL_RendererException();
+    }
+}
+#endif
+
 SDL_Point Window::get_size()
 {
     SDL_Point size;
@@ -58,6 +78,7 @@ void Renderer::clear()
 
 void Renderer::present()
 {
+    ScopedTimer timer("present");
     SDL_RenderPresent(this->renderer);
 }
 
@@ -82,3 +103,54 @@ SDL_Point Window::toggle_fullscreen()
     SDL_GetWindowSize(window, &(window_size.x), &(window_size.y));
     return window_size;
 }
+
+void Damage::scroll(SDL_Rect area, SDL_Point offset)
+{
+    if (offset.x == 0 && offset.y == 0)
+        return;
+    // one scroll per frame, another one or one beyond the area draws all of it again
+    if (this->scroll_area.w > 0 || std::abs(offset.x) >= area.w || std::abs(offset.y) >= area.h)
+    {
+        this->add(area);
+        return;
+    }
+    this->scroll_area = area;
+    this->scrolled = offset;
+    if (offset.x > 0)
+        this->add({area.x, area.y, offset.x, area.h});
+    else if (offset.x < 0)
+        this->add({area.x + area.w + offset.x, area.y, -offset.x, area.h});
+    if (offset.y > 0)
+        this->add({area.x, area.y, area.w, offset.y});
+    else if (offset.y < 0)
+        this->add({area.x, area.y + area.h + offset.y, area.w, -offset.y});
+}
+
+void Damage::add(SDL_Rect rect)
+{
+    if (rect.w <= 0 || rect.h <= 0)
+        return;
+    // merging may make the area overlap others, so it is repeated until nothing overlaps anymore
+    for (size_t i = 0; i < this->rects.size();)
+    {
+        if (SDL_HasIntersection(&(this->rects[i]), &rect))
+        {
+            SDL_UnionRect(&(this->rects[i]), &rect, &rect);
+            this->rects.erase(this->rects.begin() + i);
+            i = 0;
+        }
+        else
+        {
+            i++;
+        }
+    }
+    this->rects.push_back(rect);
+    if (this->rects.size() > Damage::MAX_RECTS)
+    {
+        for (SDL_Rect &other : this->rects)
+        {
+            SDL_UnionRect(&other, &rect, &rect);
+        }
+        this->rects.assign(1, rect);
+    }
+}
@@ -8,14 +8,56 @@
 #include "SDL2/SDL.h"
 #include "SDL2/SDL_ttf.h"
 #include "Exceptions.hpp"
+#include "Profiler.hpp"
 #include <stdio.h>
 #include <string>
 #include <cmath>
 #include <iostream>
 #include <sstream>
+#include <vector>
 
 SDL_Color operator!(const SDL_Color &color);
 
+// screen areas that look different from the last frame, overlapping areas are merged
+class Damage
+{
+public:
+    Damage()
+    {
+        this->scroll_area = {0, 0, 0, 0};
+        this->scrolled = {0, 0};
+    }
+
+    void add(SDL_Rect rect);
+
+    // everything in area moved by offset, the frame is shifted along before the damaged areas are drawn,
+    // so only the strips that came into view are damaged
+    void scroll(SDL_Rect area, SDL_Point offset);
+
+    void clear()
+    {
+        this->rects.clear();
+        this->scroll_area = {0, 0, 0, 0};
+        this->scrolled = {0, 0};
+    }
+
+    bool empty() { return this->rects.empty(); }
+
+    const std::vector<SDL_Rect> &get_rects() { return this->rects; }
+
+    // an empty area if nothing was scrolled
+    SDL_Rect get_scroll_area() { return this->scroll_area; }
+
+    SDL_Point get_scrolled() { return this->scrolled; }
+
+    // with more areas they are merged into their bounding box, redrawing them one by one isn't worth it
+    static const size_t MAX_RECTS = 8;
+private:
+    std::vector<SDL_Rect> rects;
+    SDL_Rect scroll_area;
+    SDL_Point scrolled;
+};
+
 class Window
 {
 private:
@@ -83,6 +125,14 @@ public:
 
     void fill_rect(SDL_Rect *rect);
 
+    // nullptr disables clipping
+    void set_clip_rect(const SDL_Rect *rect);
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    void render_geometry(SDL_Texture *texture, const std::vector<SDL_Vertex> &vertices,
+                         const std::vector<int> &indices);
+#endif
+
 private:
     SDL_Renderer *renderer;
 };